@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef KISS_TEMPLATES_BENCHMARKS_ANY_SERIALIZER_DATA_H
+#define KISS_TEMPLATES_BENCHMARKS_ANY_SERIALIZER_DATA_H
+
+#include <string>
+#include <vector>
+
+namespace bench
+{
+  struct Row
+  {
+    long id;
+    std::string kind;
+    std::string name;
+    std::string description;
+    unsigned count;
+    double price;
+    int delta;
+    std::string badge;
+  };
+
+  struct Data
+  {
+    std::string title;
+    std::vector<Row> rows;
+    std::string user;
+    std::string date;
+    double total;
+    std::string currency;
+  };
+
+  inline auto make_data(std::size_t rows) -> Data
+  {
+    auto data = Data{"Inventory <all>", {}, "Jane & John", "2016-01-01", 0.0, "EUR"};
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      const auto price = 0.25 * static_cast<double>(i % 40);
+      data.rows.push_back(Row{static_cast<long>(i), i % 2 ? "odd" : "even",
+                              "Item #" + std::to_string(i),
+                              "A \"quoted\" description of item " + std::to_string(i),
+                              static_cast<unsigned>(i % 7), price, static_cast<int>(i % 5) - 2,
+                              "<b>new</b>"});
+      data.total += price;
+    }
+    return data;
+  }
+}
+
+#endif
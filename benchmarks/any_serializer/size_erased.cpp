@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Renders the page with four different serializers, see sizes.cmake
+#include <iostream>
+#include <kiste/any_serializer.h>
+#include <kiste/cpp.h>
+#include <kiste/html.h>
+#include <kiste/serializer_builder.h>
+#include <page.h>
+#include "data.h"
+
+namespace
+{
+  struct html : kiste::html
+  {
+    html(std::ostream& os) : kiste::html(os)
+    {
+    }
+
+    template <typename SerializerT, typename T>
+    void escape(SerializerT&, const T& t)
+    {
+      kiste::html::escape(t);
+    }
+  };
+
+  // Serializes floating point numbers as cents
+  struct cents_policy
+  {
+    template <typename SerializerT>
+    void escape(SerializerT& serializer, const double& value)
+    {
+      serializer.escape(static_cast<long long>(value * 100));
+      serializer.text(" ct");
+    }
+  };
+
+  // Serializes ids with a leading hash sign
+  struct id_policy
+  {
+    template <typename SerializerT>
+    void escape(SerializerT& serializer, const long& value)
+    {
+      serializer.text("#");
+      serializer.escape(static_cast<long long>(value));
+    }
+  };
+
+  auto make_cents_serializer(std::ostream& os)
+      -> decltype(kiste::build_serializer(html{os}, cents_policy{}))
+  {
+    return kiste::build_serializer(html{os}, cents_policy{});
+  }
+
+  auto make_cents_id_serializer(std::ostream& os)
+      -> decltype(kiste::build_serializer(html{os}, cents_policy{}, id_policy{}))
+  {
+    return kiste::build_serializer(html{os}, cents_policy{}, id_policy{});
+  }
+
+  template <typename Serializer>
+  auto render(const bench::Data& data, Serializer& serializer) -> void
+  {
+    bench::Page(data, serializer).render();
+  }
+}
+
+namespace
+{
+  auto render_erased(const bench::Data& data, kiste::any_serializer_backend& backend) -> void
+  {
+    kiste::any_serializer serializer{backend};
+    render(data, serializer);
+  }
+}
+
+int main()
+{
+  const auto data = bench::make_data(3);
+  auto& os = std::cout;
+
+  kiste::any_serializer_backend_t<kiste::html> html_backend{os};
+  render_erased(data, html_backend);
+  kiste::any_serializer_backend_t<kiste::cpp> cpp_backend{os};
+  render_erased(data, cpp_backend);
+  kiste::any_serializer_backend_t<decltype(make_cents_serializer(os))> cents_backend{
+      os, make_cents_serializer};
+  render_erased(data, cents_backend);
+  kiste::any_serializer_backend_t<decltype(make_cents_id_serializer(os))> cents_id_backend{
+      os, make_cents_id_serializer};
+  render_erased(data, cents_id_backend);
+}
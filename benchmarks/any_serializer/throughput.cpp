@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Renders the page with kiste::html directly and via kiste::any_serializer
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <kiste/any_serializer.h>
+#include <kiste/html.h>
+#include <page.h>
+#include "data.h"
+
+namespace
+{
+  // Discards the output, so that only the rendering is measured
+  class null_buffer : public std::streambuf
+  {
+  protected:
+    auto overflow(int_type c) -> int_type override
+    {
+      return traits_type::not_eof(c);
+    }
+
+    auto xsputn(const char*, std::streamsize n) -> std::streamsize override
+    {
+      return n;
+    }
+  };
+
+  template <typename Render>
+  auto measure(const char* name, std::size_t bytes, std::size_t runs, Render render) -> void
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < runs; ++i)
+    {
+      render();
+    }
+    const auto seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << (bytes * runs) / seconds / (1024 * 1024) << " MB/s" << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const auto runs = argc > 1 ? std::stoul(argv[1]) : 200ul;
+  const auto data = bench::make_data(1000);
+
+  std::ostringstream sample;
+  {
+    auto serializer = kiste::html{sample};
+    bench::Page(data, serializer).render();
+  }
+  const auto bytes = sample.str().size();
+
+  null_buffer buffer;
+  std::ostream os(&buffer);
+
+  measure("kiste::html", bytes, runs, [&]()
+          {
+            auto serializer = kiste::html{os};
+            bench::Page(data, serializer).render();
+          });
+
+  kiste::any_serializer_backend_t<kiste::html> backend{os};
+  measure("kiste::any_serializer", bytes, runs, [&]()
+          {
+            kiste::any_serializer serializer{backend};
+            bench::Page(data, serializer).render();
+            serializer.flush();
+          });
+}
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2015-2015, Roland Bock
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#   Redistributions of source code must retain the above copyright notice, this
+#   list of conditions and the following disclaimer.
+#
+#   Redistributions in binary form must reproduce the above copyright notice, this
+#   list of conditions and the following disclaimer in the documentation and/or
+#   other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+# ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Synthesizes templates, generates them with kiste2cpp for several sets of code generation
+# options and compiles them. Reports generation time, compile time, peak compiler memory and
+# object size per option set as JSON.
+#
+# Each of the N synthesized units consists of an inheritance chain of D templates. The leaf of
+# the chain has M member templates and K $call{} lines, and one translation unit renders it.
+
+import argparse
+import json
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+OPTION_SETS = {
+    "default": [],
+    "fast_compile": ["--fast-compile"],
+    "no_line_directives": ["--no-line-directives"],
+    "report_exceptions": ["--report-exceptions"],
+    "report_exceptions_per_function": ["--report-exceptions-per-function"],
+}
+
+DATA_H = """#pragma once
+#include <exception>
+#include <string>
+#include <vector>
+#include <kiste/html.h>
+
+namespace bench
+{
+  struct Data
+  {
+    std::string name;
+    int count;
+    double value;
+    std::vector<std::string> items;
+  };
+
+  // Also supports --report-exceptions
+  struct Serializer : kiste::html
+  {
+    using kiste::html::html;
+
+    auto report_exception(long, const std::string&, std::exception_ptr) -> void
+    {
+    }
+  };
+}
+"""
+
+
+def class_name(unit, level):
+    return "Unit%dLevel%d" % (unit, level)
+
+
+def member_template(member):
+    return """%%namespace bench
+%%{
+  $class Member%d
+
+  %%auto render_item(int i) -> void
+  %%{
+    <li class="member%d">${data.name} #${i}: ${data.value * i}</li>
+  %%}
+
+  $endclass
+%%}
+""" % (member, member)
+
+
+def level_template(unit, level, depth, members, calls):
+    name = class_name(unit, level)
+    lines = []
+    if level > 0:
+        lines.append("%%#include <%s.h>" % class_name(unit, level - 1).lower())
+    if level == depth - 1:
+        lines += ["%%#include <member%d.h>" % m for m in range(members)]
+    lines += ["", "%namespace bench", "%{"]
+    if level > 0:
+        lines.append("  $class %s : %s" % (name, class_name(unit, level - 1)))
+    else:
+        lines.append("  $class %s" % name)
+    if level == depth - 1:
+        lines += ["  $member Member%d member%d" % (m, m) for m in range(members)]
+    lines += [
+        "",
+        "  %%auto section%d() -> void" % level,
+        "  %{",
+        "    <section id=\"%s\">" % name,
+        "      <h2>${data.name} (level %d)</h2>" % level,
+        "      <p>${data.count} items worth ${data.value}, ${data.count * %d}</p>" % (level + 1),
+        "      %for (const auto& item : data.items)",
+        "      %{",
+        "      <p>${item} in $raw{data.name}</p>",
+        "      %}",
+        "    </section>",
+        "  %}",
+    ]
+    if level == depth - 1:
+        lines += ["", "  %auto render() -> void", "  %{", "    <html><body>"]
+        for call in range(calls):
+            if members and call % 2 == 0:
+                lines.append("    $call{member%d.render_item(%d)}" % ((call // 2) % members, call))
+            elif level > 0:
+                lines.append("    $call{parent.section%d()}" % (call % level))
+            else:
+                lines.append("    $call{section0()}")
+        lines += ["    </body></html>", "  %}"]
+    lines += ["", "  $endclass", "%}", ""]
+    return "\n".join(lines)
+
+
+def translation_unit(unit, depth):
+    return """#include <ostream>
+#include "data.h"
+#include <%s.h>
+
+auto render_unit%d(std::ostream& os, const bench::Data& data) -> void
+{
+  auto serializer = bench::Serializer{os};
+  bench::%s(data, serializer).render();
+}
+""" % (class_name(unit, depth - 1).lower(), unit, class_name(unit, depth - 1))
+
+
+def write(path, content):
+    with open(path, "w") as f:
+        f.write(content)
+
+
+def synthesize(directory, args):
+    templates = []
+    for member in range(args.members):
+        path = os.path.join(directory, "member%d.kiste" % member)
+        write(path, member_template(member))
+        templates.append(path)
+    sources = []
+    for unit in range(args.templates):
+        for level in range(args.depth):
+            path = os.path.join(directory, class_name(unit, level).lower() + ".kiste")
+            write(path, level_template(unit, level, args.depth, args.members, args.calls))
+            templates.append(path)
+        path = os.path.join(directory, "unit%d.cpp" % unit)
+        write(path, translation_unit(unit, args.depth))
+        sources.append(path)
+    write(os.path.join(directory, "data.h"), DATA_H)
+    return templates, sources
+
+
+def run(command):
+    """Runs command, returns wall time in seconds and peak memory in KB (including the processes
+    started by command, e.g. cc1plus)"""
+    start = time.monotonic()
+    process = subprocess.Popen(command)
+    _, status, usage = os.wait4(process.pid, 0)
+    process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else 1
+    if process.returncode != 0:
+        sys.exit("Command failed: %s" % " ".join(command))
+    return time.monotonic() - start, usage.ru_maxrss
+
+
+def measure(directory, templates, sources, args, options):
+    output_dir = os.path.join(directory, "generated")
+    shutil.rmtree(output_dir, ignore_errors=True)
+    os.makedirs(output_dir)
+
+    generate_seconds, _ = run([args.kiste2cpp] + options + ["--output-dir", output_dir] +
+                              templates)
+    header_bytes = sum(os.path.getsize(os.path.join(output_dir, f))
+                       for f in os.listdir(output_dir) if f.endswith(".h"))
+
+    compile_seconds = 0.0
+    peak_rss_kb = 0
+    object_bytes = 0
+    for source in sources:
+        obj = os.path.join(output_dir, os.path.basename(source) + ".o")
+        seconds, rss = run([args.compiler] + args.flags + ["-I" + args.include, "-I" +
+                                                            output_dir, "-I" + directory, "-c",
+                                                            source, "-o", obj])
+        compile_seconds += seconds
+        peak_rss_kb = max(peak_rss_kb, rss)
+        object_bytes += os.path.getsize(obj)
+
+    return {
+        "options": options,
+        "generate_seconds": round(generate_seconds, 4),
+        "compile_seconds": round(compile_seconds, 4),
+        "peak_compiler_rss_kb": peak_rss_kb,
+        "header_bytes": header_bytes,
+        "object_bytes": object_bytes,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Measures the compile time of synthesized templates")
+    parser.add_argument("--kiste2cpp", required=True)
+    parser.add_argument("--compiler", required=True)
+    parser.add_argument("--include", required=True, help="directory containing kiste/")
+    parser.add_argument("--flags", default="-std=c++11 -O2", help="compiler flags")
+    parser.add_argument("--templates", type=int, default=4, help="number of units (N)")
+    parser.add_argument("--depth", type=int, default=3, help="inheritance depth (D)")
+    parser.add_argument("--members", type=int, default=4, help="member templates (M)")
+    parser.add_argument("--calls", type=int, default=50, help="$call{} lines per leaf (K)")
+    parser.add_argument("--option-sets", default=",".join(sorted(OPTION_SETS)),
+                        help="comma separated, out of %s" % ", ".join(sorted(OPTION_SETS)))
+    parser.add_argument("--output", help="write the JSON report to this file")
+    args = parser.parse_args()
+    args.flags = shlex.split(args.flags)
+    if args.depth < 1 or args.templates < 1:
+        sys.exit("--depth and --templates have to be positive")
+
+    directory = tempfile.mkdtemp(prefix="kiste_compile_time_")
+    try:
+        templates, sources = synthesize(directory, args)
+        results = {}
+        for name in args.option_sets.split(","):
+            if name not in OPTION_SETS:
+                sys.exit("Unknown option set: %s" % name)
+            results[name] = measure(directory, templates, sources, args, OPTION_SETS[name])
+    finally:
+        shutil.rmtree(directory, ignore_errors=True)
+
+    report = json.dumps({
+        "parameters": {
+            "templates": args.templates,
+            "depth": args.depth,
+            "members": args.members,
+            "calls": args.calls,
+            "compiler": args.compiler,
+            "flags": args.flags,
+        },
+        "results": results,
+    }, indent=2, sort_keys=True)
+    if args.output:
+        write(args.output, report + "\n")
+    print(report)
+
+
+if __name__ == "__main__":
+    main()
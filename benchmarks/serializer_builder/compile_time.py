@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+# Copyright (c) 2015-2015, Roland Bock
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+#
+#   Redistributions of source code must retain the above copyright notice, this
+#   list of conditions and the following disclaimer.
+#
+#   Redistributions in binary form must reproduce the above copyright notice, this
+#   list of conditions and the following disclaimer in the documentation and/or
+#   other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+# ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Measures how long the compiler takes for escape.cpp with different numbers of policies.
+# Usage: compile_time.py COMPILER INCLUDE_DIR SOURCE [FLAG]...
+
+import subprocess
+import sys
+import tempfile
+import time
+import os
+
+
+def compile_time(command, repetitions):
+    best = None
+    for _ in range(repetitions):
+        start = time.monotonic()
+        subprocess.check_call(command)
+        elapsed = time.monotonic() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    if len(sys.argv) < 4:
+        sys.exit("Usage: compile_time.py COMPILER INCLUDE_DIR SOURCE [FLAG]...")
+    compiler, include_dir, source = sys.argv[1:4]
+    flags = sys.argv[4:]
+
+    with tempfile.TemporaryDirectory() as directory:
+        output = os.path.join(directory, "escape.o")
+        for policies in (2, 8, 32):
+            command = [compiler] + flags + ["-I" + include_dir, "-DKISTE_POLICIES=%d" % policies,
+                                            "-c", source, "-o", output]
+            seconds = compile_time(command, 3)
+            print("%d policies: compiled in %.3f s, object size %d bytes"
+                  % (policies, seconds, os.path.getsize(output)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Escapes values through a serializer built from KISTE_POLICIES policies
+#include <chrono>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <kiste/html.h>
+#include <kiste/serializer_builder.h>
+
+#ifndef KISTE_POLICIES
+#define KISTE_POLICIES 8
+#endif
+
+namespace
+{
+  struct html : kiste::html
+  {
+    html(std::ostream& os) : kiste::html(os)
+    {
+    }
+
+    template <typename SerializerT, typename T>
+    void escape(SerializerT&, const T& t)
+    {
+      kiste::html::escape(t);
+    }
+  };
+
+  template <int I>
+  struct value_t
+  {
+    int _value;
+  };
+
+  template <int I>
+  struct policy_t
+  {
+    template <typename SerializerT>
+    void escape(SerializerT& serializer, const value_t<I>& value)
+    {
+      serializer.escape(value._value + I);
+    }
+  };
+
+  template <int... I>
+  struct indices
+  {
+  };
+
+  template <int N, int... I>
+  struct make_indices : make_indices<N - 1, N - 1, I...>
+  {
+  };
+
+  template <int... I>
+  struct make_indices<0, I...>
+  {
+    using type = indices<I...>;
+  };
+
+  template <int... I>
+  auto make_serializer(std::ostream& os, indices<I...>)
+      -> decltype(kiste::build_serializer(html{os}, policy_t<I>{}...))
+  {
+    return kiste::build_serializer(html{os}, policy_t<I>{}...);
+  }
+
+  template <typename Serializer, int... I>
+  auto escape_all(Serializer& serializer, int value, indices<I...>) -> void
+  {
+    const int expand[] = {(serializer.escape(value_t<I>{value}), 0)...};
+    static_cast<void>(expand);
+    serializer.escape("text & more");
+  }
+
+  class null_buffer : public std::streambuf
+  {
+  protected:
+    auto overflow(int_type c) -> int_type override
+    {
+      return traits_type::not_eof(c);
+    }
+
+    auto xsputn(const char*, std::streamsize n) -> std::streamsize override
+    {
+      return n;
+    }
+  };
+}
+
+int main(int argc, char** argv)
+{
+  const auto runs = argc > 1 ? std::stoi(argv[1]) : 1000000;
+  using policies = make_indices<KISTE_POLICIES>::type;
+
+  null_buffer buffer;
+  std::ostream os(&buffer);
+  auto serializer = make_serializer(os, policies{});
+
+  const auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < runs; ++i)
+  {
+    escape_all(serializer, i, policies{});
+  }
+  const auto seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << KISTE_POLICIES << " policies: "
+            << seconds * 1e9 / (static_cast<double>(runs) * (KISTE_POLICIES + 1)) << " ns per escape"
+            << std::endl;
+}
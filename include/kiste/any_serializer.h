@@ -0,0 +1,327 @@
+#ifndef KISS_TEMPLATES_KISTE_ANY_SERIALIZER_H
+#define KISS_TEMPLATES_KISTE_ANY_SERIALIZER_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <kiste/buffer_stream.h>
+#include <kiste/raw_type.h>
+
+namespace kiste
+{
+  // The virtual interface behind any_serializer. Escaped values are appended to the buffer of the
+  // any_serializer, finished chunks of output are handed to write().
+  class any_serializer_backend
+  {
+  public:
+    virtual ~any_serializer_backend() = default;
+
+    virtual auto write(const char* data, std::size_t size) -> void = 0;
+    // Strings of more than one character are terminated, i.e. data[size] is '\0'
+    virtual auto escape(std::string& out, const char* data, std::size_t size) -> void = 0;
+    virtual auto escape(std::string& out, long long value) -> void = 0;
+    virtual auto escape(std::string& out, unsigned long long value) -> void = 0;
+    virtual auto escape(std::string& out, long double value) -> void = 0;
+
+    virtual auto raw(std::string& out, const char* data, std::size_t size) -> void
+    {
+      out.append(data, size);
+    }
+
+    virtual auto report_exception(long, const std::string&, std::exception_ptr e) -> void
+    {
+      std::rethrow_exception(e);
+    }
+  };
+
+  // A serializer type that templates can be instantiated with once, instead of once per
+  // serializer type. Text is collected in a buffer and passed on to the backend in chunks.
+  class any_serializer
+  {
+    any_serializer_backend& _backend;
+    std::string _buffer;
+    std::size_t _chunk_size;
+
+    auto append_escaped(const char* data, std::size_t size) -> void
+    {
+      _backend.escape(_buffer, data, size);
+      flush_full_chunk();
+    }
+
+    auto append_escaped(const std::string& s) -> void
+    {
+      append_escaped(s.data(), s.size());
+    }
+
+    auto append_escaped(const char* s) -> void
+    {
+      append_escaped(s, std::strlen(s));
+    }
+
+    auto append_raw(const char* data, std::size_t size) -> void
+    {
+      _backend.raw(_buffer, data, size);
+      flush_full_chunk();
+    }
+
+    auto append_raw(const std::string& s) -> void
+    {
+      append_raw(s.data(), s.size());
+    }
+
+    auto append_raw(const char* s) -> void
+    {
+      append_raw(s, std::strlen(s));
+    }
+
+    auto flush_full_chunk() -> void
+    {
+      if (_buffer.size() >= _chunk_size)
+        flush();
+    }
+
+  public:
+    any_serializer(any_serializer_backend& backend, std::size_t chunk_size = 4096)
+        : _backend(backend), _chunk_size(chunk_size)
+    {
+      _buffer.reserve(chunk_size + chunk_size / 4);
+    }
+
+    any_serializer() = delete;
+    any_serializer(const any_serializer&) = delete;
+    any_serializer(any_serializer&& rhs)
+        : _backend(rhs._backend), _buffer(std::move(rhs._buffer)), _chunk_size(rhs._chunk_size)
+    {
+      rhs._buffer.clear();
+    }
+    any_serializer& operator=(const any_serializer&) = delete;
+    any_serializer& operator=(any_serializer&&) = delete;
+
+    // Output that has not been flushed yet is written here. Call flush() explicitly if you need
+    // to see exceptions thrown by the backend.
+    ~any_serializer()
+    {
+      try
+      {
+        flush();
+      }
+      catch (...)
+      {
+      }
+    }
+
+    auto flush() -> void
+    {
+      if (not _buffer.empty())
+      {
+        _backend.write(_buffer.data(), _buffer.size());
+        _buffer.clear();
+      }
+    }
+
+    auto text(const char* text) -> void
+    {
+      _buffer.append(text);
+      flush_full_chunk();
+    }
+
+    auto text(const char* text, std::size_t size) -> void
+    {
+      _buffer.append(text, size);
+      flush_full_chunk();
+    }
+
+    auto escape(const char& c) -> void
+    {
+      append_escaped(&c, 1);
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value and std::is_signed<T>::value>::type* =
+                  nullptr>
+    auto escape(const T& t) -> void
+    {
+      _backend.escape(_buffer, static_cast<long long>(t));
+      flush_full_chunk();
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value and
+                                      std::is_unsigned<T>::value>::type* = nullptr>
+    auto escape(const T& t) -> void
+    {
+      _backend.escape(_buffer, static_cast<unsigned long long>(t));
+      flush_full_chunk();
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    auto escape(const T& t) -> void
+    {
+      _backend.escape(_buffer, static_cast<long double>(t));
+      flush_full_chunk();
+    }
+
+    template <typename T>
+    auto escape(const raw_t<T>& r) -> void
+    {
+      raw(r._t);
+    }
+
+    template <typename T>
+    auto escape(const conditionally_raw_t<T>& cr) -> void
+    {
+      if (cr._is_raw)
+        raw(cr._t);
+      else
+        escape(cr._t);
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_convertible<T, std::string>::value>::type* = nullptr>
+    auto escape(const T& t) -> void
+    {
+      append_escaped(t);
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_convertible<T, std::string>::value>::type* = nullptr>
+    auto raw(const T& t) -> void
+    {
+      append_raw(t);
+    }
+
+    template <typename T,
+              typename std::enable_if<not std::is_convertible<T, std::string>::value>::type* =
+                  nullptr>
+    auto raw(const T& t) -> void
+    {
+      std::ostringstream os;
+      os << t;
+      append_raw(os.str());
+    }
+
+    auto report_exception(long line_no, const std::string& expression, std::exception_ptr e)
+        -> void
+    {
+      _backend.report_exception(line_no, expression, e);
+    }
+  };
+
+  // Adapts a serializer like kiste::html to any_serializer. The serializer writes to an ostream
+  // that appends to the buffer of the any_serializer. The resulting chunks are written to `os`.
+  template <typename Serializer>
+  class any_serializer_backend_t : public any_serializer_backend
+  {
+    string_appender _appender;  // appends to the buffer of the any_serializer
+    std::ostream _stream;
+    Serializer _serializer;
+    std::ostream& _os;
+
+    // Terminated strings without embedded NULs are passed on in place, without a temporary copy
+    static auto is_c_str(const char* data, std::size_t size) -> bool
+    {
+      return std::memchr(data, '\0', size) == nullptr;
+    }
+
+  public:
+    any_serializer_backend_t(std::ostream& os)
+        : _stream(&_appender), _serializer(_stream), _os(os)
+    {
+    }
+
+    // For serializers that are not constructed from an ostream, e.g. those built with
+    // build_serializer: `factory(stream)` returns a serializer writing to `stream`.
+    template <typename Factory>
+    any_serializer_backend_t(std::ostream& os, Factory&& factory)
+        : _stream(&_appender), _serializer(factory(_stream)), _os(os)
+    {
+    }
+
+    any_serializer_backend_t(const any_serializer_backend_t&) = delete;
+    any_serializer_backend_t& operator=(const any_serializer_backend_t&) = delete;
+
+    auto write(const char* data, std::size_t size) -> void override
+    {
+      _os.write(data, static_cast<std::streamsize>(size));
+    }
+
+    auto escape(std::string& out, const char* data, std::size_t size) -> void override
+    {
+      _appender.set_target(out);
+      if (size == 1)
+        _serializer.escape(*data);
+      else if (is_c_str(data, size))
+        _serializer.escape(data);
+      else
+        _serializer.escape(std::string(data, size));
+    }
+
+    auto escape(std::string& out, long long value) -> void override
+    {
+      _appender.set_target(out);
+      _serializer.escape(value);
+    }
+
+    auto escape(std::string& out, unsigned long long value) -> void override
+    {
+      _appender.set_target(out);
+      _serializer.escape(value);
+    }
+
+    auto escape(std::string& out, long double value) -> void override
+    {
+      _appender.set_target(out);
+      _serializer.escape(value);
+    }
+
+    auto raw(std::string& out, const char* data, std::size_t size) -> void override
+    {
+      _appender.set_target(out);
+      if (is_c_str(data, size))
+        _serializer.escape(raw_t<const char*>(data));
+      else
+        _serializer.escape(raw_t<std::string>(std::string(data, size)));
+    }
+
+    auto serializer() -> Serializer&
+    {
+      return _serializer;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef KISS_TEMPLATES_KISTE_BUFFER_STREAM_H
+#define KISS_TEMPLATES_KISTE_BUFFER_STREAM_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include <kiste/pmr.h>
+
+namespace kiste
+{
+  // A streambuf that appends to a string, e.g. std::string or std::pmr::string
+  template <typename String>
+  class basic_string_appender : public std::streambuf
+  {
+    String* _out = nullptr;
+
+  protected:
+    auto overflow(int_type c) -> int_type override
+    {
+      if (!traits_type::eq_int_type(c, traits_type::eof()))
+        _out->push_back(traits_type::to_char_type(c));
+      return traits_type::not_eof(c);
+    }
+
+    auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+    {
+      _out->append(s, static_cast<std::size_t>(n));
+      return n;
+    }
+
+  public:
+    basic_string_appender() = default;
+
+    explicit basic_string_appender(String& out) : _out(&out)
+    {
+    }
+
+    auto set_target(String& out) -> void
+    {
+      _out = &out;
+    }
+  };
+
+  using string_appender = basic_string_appender<std::string>;
+
+  // An ostream that appends to a string. Unlike std::ostringstream, the string can be cleared and
+  // reused without giving up its capacity, e.g. for rendering many records in a row.
+  template <typename String>
+  class basic_buffer_stream : public std::ostream
+  {
+    basic_string_appender<String> _appender;
+
+  public:
+    explicit basic_buffer_stream(String& buffer) : std::ostream(nullptr), _appender(buffer)
+    {
+      rdbuf(&_appender);
+    }
+
+    basic_buffer_stream(const basic_buffer_stream&) = delete;
+    basic_buffer_stream& operator=(const basic_buffer_stream&) = delete;
+  };
+
+  using buffer_stream = basic_buffer_stream<std::string>;
+
+#if KISTE_PMR
+  // Appends to a std::pmr::string, so the output can live in a per-render arena as well
+  using pmr_buffer_stream = basic_buffer_stream<std::pmr::string>;
+#endif
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef KISS_TEMPLATES_KISTE_COMPILER_H
+#define KISS_TEMPLATES_KISTE_COMPILER_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// In-process interface of kiste2cpp, provided by the kiste_compiler library.
+// All state lives in the arguments and results, so independent templates can be compiled
+// concurrently from several threads.
+
+namespace kiste
+{
+  // A member function of a template class
+  struct function_info
+  {
+    std::string _name;
+    bool _static_text = false;  // takes no arguments and emits nothing but text
+    std::string _text;          // the text emitted by the function, if _static_text
+  };
+
+  // A template class at namespace scope
+  struct class_info
+  {
+    std::string _namespace;  // e.g. "a::b", empty for the global namespace
+    std::string _name;
+    std::string _parent_name;                      // as written in the template
+    std::vector<std::string> _member_class_names;  // as written in the template
+    std::vector<std::string> _member_names;        // in the order of _member_class_names
+    std::vector<function_info> _functions;         // in the order of declaration
+  };
+
+  // Data and serializer types for explicit instantiations, see kiste2cpp --instantiate
+  struct instantiation
+  {
+    std::string _data_type;
+    std::string _serializer_type;
+  };
+
+  struct compiler_options
+  {
+    bool _report_exceptions = false;               // see kiste2cpp --report-exceptions
+    bool _report_exceptions_per_function = false;  // see --report-exceptions-per-function
+    bool _report_errors = false;                   // see kiste2cpp --report-errors
+    bool _line_directives = true;                  // see kiste2cpp --no-line-directives
+    bool _fast_compile = false;                    // see kiste2cpp --fast-compile
+
+    // $call{}s of functions that emit nothing but text are replaced by that text. The functions
+    // are looked up in _known_classes, which therefore should contain the classes of this
+    // template, too. See kiste2cpp --fuse-static-calls.
+    bool _fuse_static_calls = false;
+
+    // Classes of the template are instantiated explicitly for each of these types, along with
+    // their parents and members. The generated header declares these instantiations `extern`,
+    // compile_result::_instantiation_definitions contains the definitions.
+    std::vector<instantiation> _instantiations;
+    std::vector<std::string> _instantiation_includes;  // e.g. "#include <data.h>"
+    std::vector<class_info> _known_classes;  // classes of other templates, e.g. parents
+  };
+
+  struct diagnostic
+  {
+    std::string _filename;
+    std::size_t _line_no = 0;
+    std::string _message;
+    std::string _line;  // the offending template line
+  };
+
+  struct compile_result
+  {
+    bool _success = false;
+    std::string _code;  // the generated header, empty for the stream interface or on failure
+    std::vector<diagnostic> _diagnostics;
+    std::vector<std::string> _includes;  // targets of all %#include directives of the template
+    std::vector<class_info> _classes;
+    std::string _instantiation_definitions;  // to be compiled after including the header
+  };
+
+  // Reads a template from is and writes the generated header to os. The filename is used for
+  // #line directives and diagnostics only. If compilation fails, os contains partial output.
+  auto compile(std::istream& is,
+               std::ostream& os,
+               const std::string& filename,
+               const compiler_options& options = compiler_options{}) -> compile_result;
+
+  // Compiles a template given as a string
+  auto compile(const std::string& source,
+               const std::string& filename,
+               const compiler_options& options = compiler_options{}) -> compile_result;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef KISS_TEMPLATES_KISTE_ERROR_CHANNEL_H
+#define KISS_TEMPLATES_KISTE_ERROR_CHANNEL_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <type_traits>
+#include <utility>
+#include <kiste/cold.h>
+
+// Error reporting without exceptions, see kiste2cpp --report-errors. Data accessors and
+// $call{}ed functions may return an error state (e.g. kiste::result<T>). The generated code
+// checks it and hands errors to the serializer's
+//
+//   auto report_error(long line_no, const char* expression, int code) -> bool;
+//
+// Rendering of the current member function continues if report_error returns true. Otherwise, the
+// function returns early (functions that do not return void and lambdas always continue).
+
+namespace kiste
+{
+  struct error
+  {
+    int _code;
+  };
+
+  // Either a value or an error code. Construction from an error requires T to be default
+  // constructible.
+  template <typename T>
+  class result
+  {
+    T _value;
+    bool _has_error;
+    int _error_code;
+
+  public:
+    result(T value) : _value(std::move(value)), _has_error(false), _error_code(0)
+    {
+    }
+
+    result(error e) : _value(), _has_error(true), _error_code(e._code)
+    {
+    }
+
+    auto has_error() const -> bool
+    {
+      return _has_error;
+    }
+
+    auto error_code() const -> int
+    {
+      return _error_code;
+    }
+
+    auto value() const -> const T&
+    {
+      return _value;
+    }
+  };
+
+  // The result of a function used in $call{}
+  template <>
+  class result<void>
+  {
+    bool _has_error;
+    int _error_code;
+
+  public:
+    result() : _has_error(false), _error_code(0)
+    {
+    }
+
+    result(error e) : _has_error(true), _error_code(e._code)
+    {
+    }
+
+    auto has_error() const -> bool
+    {
+      return _has_error;
+    }
+
+    auto error_code() const -> int
+    {
+      return _error_code;
+    }
+  };
+
+  // Specialize for your own error states
+  template <typename T>
+  struct error_traits
+  {
+    static constexpr bool _is_error_state = false;
+
+    static auto has_error(const T&) -> bool
+    {
+      return false;
+    }
+
+    static auto error_code(const T&) -> int
+    {
+      return 0;
+    }
+
+    static auto value(const T& t) -> const T&
+    {
+      return t;
+    }
+  };
+
+  template <typename T>
+  struct error_traits<result<T>>
+  {
+    static constexpr bool _is_error_state = true;
+
+    static auto has_error(const result<T>& r) -> bool
+    {
+      return r.has_error();
+    }
+
+    static auto error_code(const result<T>& r) -> int
+    {
+      return r.error_code();
+    }
+
+    static auto value(const result<T>& r) -> const T&
+    {
+      return r.value();
+    }
+  };
+
+  template <>
+  struct error_traits<result<void>>
+  {
+    static constexpr bool _is_error_state = true;
+
+    static auto has_error(const result<void>& r) -> bool
+    {
+      return r.has_error();
+    }
+
+    static auto error_code(const result<void>& r) -> int
+    {
+      return r.error_code();
+    }
+  };
+
+  template <typename Serializer>
+  KISTE_COLD auto report_error(Serializer& serialize, long line_no, const char* expression, int code)
+      -> bool
+  {
+    return serialize.report_error(line_no, expression, code);
+  }
+
+  template <typename Serializer, typename T>
+  auto checked_escape(Serializer& serialize, long line_no, const char* expression, const T& t)
+      -> bool
+  {
+    if (error_traits<T>::has_error(t))
+    {
+      return report_error(serialize, line_no, expression, error_traits<T>::error_code(t));
+    }
+    serialize.escape(error_traits<T>::value(t));
+    return true;
+  }
+
+  template <typename Serializer, typename T>
+  auto checked_raw(Serializer& serialize, long line_no, const char* expression, const T& t) -> bool
+  {
+    if (error_traits<T>::has_error(t))
+    {
+      return report_error(serialize, line_no, expression, error_traits<T>::error_code(t));
+    }
+    serialize.raw(error_traits<T>::value(t));
+    return true;
+  }
+
+  template <typename Serializer, typename Function>
+  auto checked_call(Serializer&, long, const char*, const Function& function) ->
+      typename std::enable_if<std::is_void<decltype(function())>::value, bool>::type
+  {
+    function();
+    return true;
+  }
+
+  template <typename Serializer, typename Function>
+  auto checked_call(Serializer& serialize,
+                    long line_no,
+                    const char* expression,
+                    const Function& function) ->
+      typename std::enable_if<!std::is_void<decltype(function())>::value, bool>::type
+  {
+    using result_t = typename std::decay<decltype(function())>::type;
+    static_assert(error_traits<result_t>::_is_error_state,
+                  "$call{} requires void or error state expression");
+    const auto r = function();
+    if (error_traits<result_t>::has_error(r))
+    {
+      return report_error(serialize, line_no, expression, error_traits<result_t>::error_code(r));
+    }
+    return true;
+  }
+}
+
+#endif
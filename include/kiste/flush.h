@@ -0,0 +1,64 @@
+#ifndef KISS_TEMPLATES_KISTE_FLUSH_H
+#define KISS_TEMPLATES_KISTE_FLUSH_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <type_traits>
+#include <utility>
+
+namespace kiste
+{
+  namespace flush_impl
+  {
+    template <typename Serializer, typename = void>
+    struct has_flush : std::false_type
+    {
+    };
+
+    template <typename Serializer>
+    struct has_flush<Serializer, decltype(void(std::declval<Serializer&>().flush()))>
+        : std::true_type
+    {
+    };
+  }
+
+  // Called for $flush. Serializers without flush() ignore it.
+  template <typename Serializer>
+  auto flush(Serializer& serializer) ->
+      typename std::enable_if<flush_impl::has_flush<Serializer>::value>::type
+  {
+    serializer.flush();
+  }
+
+  template <typename Serializer>
+  auto flush(Serializer&) ->
+      typename std::enable_if<not flush_impl::has_flush<Serializer>::value>::type
+  {
+  }
+}
+
+#endif
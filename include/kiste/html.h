@@ -28,6 +28,8 @@
  */
 
 #include <ostream>
+#include <string>
+#include <type_traits>
 
 #include <kiste/raw_type.h>
 
@@ -54,6 +56,11 @@ namespace kiste
       _os << text;
     }
 
+    auto flush() -> void
+    {
+      _os.flush();
+    }
+
     auto escape(const char& c) -> void
     {
       switch (c)
@@ -106,16 +113,31 @@ namespace kiste
         escape(cr._t);
     }
 
-    template <typename T,
-              typename std::enable_if<std::is_convertible<T, std::string>::value>::type* = nullptr>
-    auto escape(const T& t) -> void
+    // Strings are escaped in place, without temporary copies
+    auto escape(const char* s) -> void
     {
-      for (const auto& c : std::string(t))  // maybe specialize for char* to avoid the constructor?
+      for (; *s; ++s)
+      {
+        escape(*s);
+      }
+    }
+
+    template <typename Traits, typename Allocator>
+    auto escape(const std::basic_string<char, Traits, Allocator>& s) -> void
+    {
+      for (const auto& c : s)
       {
         escape(c);
       }
     }
 
+    template <typename T,
+              typename std::enable_if<std::is_convertible<T, std::string>::value>::type* = nullptr>
+    auto escape(const T& t) -> void
+    {
+      escape(std::string(t));
+    }
+
     template <typename T>
     auto raw(T&& t) -> void
     {
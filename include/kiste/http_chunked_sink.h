@@ -0,0 +1,191 @@
+#ifndef KISS_TEMPLATES_KISTE_HTTP_CHUNKED_SINK_H
+#define KISS_TEMPLATES_KISTE_HTTP_CHUNKED_SINK_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include <kiste/pmr.h>
+
+namespace kiste
+{
+  namespace http_chunked_impl
+  {
+    // Writes the payload straight into the buffer, behind room for the chunk header. When the
+    // stream is flushed (e.g. by $flush) or the buffer is full, the header and the trailing CRLF
+    // are filled in around the payload and the whole chunk is written at once.
+    template <typename Buffer>
+    class chunk_buffer : public std::streambuf
+    {
+    public:
+      using write_t = std::function<void(const char*, std::size_t)>;
+      using allocator_type = typename Buffer::allocator_type;
+
+    private:
+      static constexpr std::size_t header_size = sizeof(std::size_t) * 2 + 2;  // hex size, CRLF
+      static constexpr std::size_t trailer_size = 2;                           // CRLF
+
+      write_t _write;
+      Buffer _buffer;
+
+      auto reset() -> void
+      {
+        setp(_buffer.data() + header_size, _buffer.data() + _buffer.size() - trailer_size);
+      }
+
+    protected:
+      auto overflow(int_type c) -> int_type override
+      {
+        emit_chunk();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+          *pptr() = traits_type::to_char_type(c);
+          pbump(1);
+        }
+        return traits_type::not_eof(c);
+      }
+
+      auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+      {
+        auto remaining = static_cast<std::size_t>(n);
+        while (remaining)
+        {
+          if (pptr() == epptr())
+            emit_chunk();
+          const auto count = std::min(remaining, static_cast<std::size_t>(epptr() - pptr()));
+          std::memcpy(pptr(), s, count);
+          pbump(static_cast<int>(count));
+          s += count;
+          remaining -= count;
+        }
+        return n;
+      }
+
+      auto sync() -> int override
+      {
+        emit_chunk();
+        return 0;
+      }
+
+    public:
+      chunk_buffer(write_t write, std::size_t capacity, const allocator_type& allocator)
+          : _write(std::move(write)),
+            _buffer(header_size + (capacity ? capacity : 1) + trailer_size, char{}, allocator)
+      {
+        reset();
+      }
+
+      auto emit_chunk() -> void
+      {
+        const auto size = static_cast<std::size_t>(pptr() - pbase());
+        if (size == 0)
+          return;
+        auto begin = pbase() - 2;
+        begin[0] = '\r';
+        begin[1] = '\n';
+        for (auto rest = size; rest; rest /= 16)
+        {
+          *--begin = "0123456789abcdef"[rest % 16];
+        }
+        pptr()[0] = '\r';
+        pptr()[1] = '\n';
+        const auto end = pptr() + trailer_size;
+        reset();
+        _write(begin, static_cast<std::size_t>(end - begin));
+      }
+
+      auto write_last_chunk() -> void
+      {
+        _write("0\r\n\r\n", 5);
+      }
+    };
+  }
+
+  // Frames the output as HTTP/1.1 chunks (Transfer-Encoding: chunked). Each flushed region
+  // becomes one chunk, e.g. everything up to a $flush in the template. Regions larger than the
+  // capacity are split into several chunks. The payload is copied only once, into the buffer.
+  template <typename Buffer>
+  class basic_http_chunked_sink
+  {
+  public:
+    using write_t = typename http_chunked_impl::chunk_buffer<Buffer>::write_t;
+    using allocator_type = typename http_chunked_impl::chunk_buffer<Buffer>::allocator_type;
+
+  private:
+    http_chunked_impl::chunk_buffer<Buffer> _buffer;
+    std::ostream _stream;
+    bool _finished = false;
+
+  public:
+    explicit basic_http_chunked_sink(write_t write,
+                                     std::size_t capacity = 16384,
+                                     const allocator_type& allocator = allocator_type{})
+        : _buffer(std::move(write), capacity, allocator), _stream(&_buffer)
+    {
+    }
+
+    basic_http_chunked_sink(const basic_http_chunked_sink&) = delete;
+    basic_http_chunked_sink& operator=(const basic_http_chunked_sink&) = delete;
+
+    // For the serializer, e.g. kiste::html, whose flush() flushes this stream
+    auto stream() -> std::ostream&
+    {
+      return _stream;
+    }
+
+    // Writes the pending output as a chunk
+    auto flush() -> void
+    {
+      _buffer.emit_chunk();
+    }
+
+    // Writes the pending output and the last chunk, which ends the body
+    auto finish() -> void
+    {
+      if (_finished)
+        return;
+      _finished = true;
+      _buffer.emit_chunk();
+      _buffer.write_last_chunk();
+    }
+  };
+
+  using http_chunked_sink = basic_http_chunked_sink<std::vector<char>>;
+
+#if KISTE_PMR
+  // The buffer is allocated from a memory resource, e.g. an arena for the request
+  using pmr_http_chunked_sink = basic_http_chunked_sink<std::pmr::vector<char>>;
+#endif
+}
+
+#endif
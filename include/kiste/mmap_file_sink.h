@@ -0,0 +1,261 @@
+#ifndef KISS_TEMPLATES_KISTE_MMAP_FILE_SINK_H
+#define KISS_TEMPLATES_KISTE_MMAP_FILE_SINK_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "kiste/mmap_file_sink.h requires POSIX"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kiste
+{
+  struct mmap_options
+  {
+    std::size_t _window_size = std::size_t{64} << 20;  // rounded up to the page size
+    bool _populate = false;                            // MAP_POPULATE (Linux)
+    bool _huge_pages = false;                          // MADV_HUGEPAGE (Linux), if supported
+  };
+
+  namespace mmap_file_impl
+  {
+    [[noreturn]] inline auto fail(int error, const std::string& what) -> void
+    {
+      throw std::system_error(error, std::generic_category(), "kiste::mmap_file_sink: " + what);
+    }
+
+    // The put area is the current window of the file
+    class window_buffer : public std::streambuf
+    {
+      int _fd = -1;
+      mmap_options _options;
+      std::size_t _window_size;
+      std::size_t _window_offset = 0;  // in the file, everything before it is complete
+      char* _window = nullptr;
+      int _error = 0;  // of the streambuf functions, which must not throw, reported by close()
+      const char* _what = nullptr;
+
+      auto unmap() -> void
+      {
+        if (_window)
+        {
+          ::munmap(_window, _window_size);
+          _window = nullptr;
+        }
+        setp(nullptr, nullptr);
+      }
+
+      auto record(int error, const char* what) -> bool
+      {
+        _error = error;
+        _what = what;
+        return false;
+      }
+
+      // Extends the file and maps the next window. The window is allocated on disk first, since
+      // writing to a sparse mapping on a full disk raises SIGBUS.
+      auto map_next() -> bool
+      {
+        if (_error || _fd < 0)
+          return false;
+        if (_window)
+        {
+          _window_offset += _window_size;
+          unmap();
+        }
+#if defined(__APPLE__)
+        if (::ftruncate(_fd, static_cast<off_t>(_window_offset + _window_size)) != 0)
+          return record(errno, "cannot extend file");
+#else
+        if (const auto error = ::posix_fallocate(_fd, static_cast<off_t>(_window_offset),
+                                                 static_cast<off_t>(_window_size)))
+          return record(error, "cannot extend file");
+#endif
+        auto flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        if (_options._populate)
+          flags |= MAP_POPULATE;
+#endif
+        const auto p = ::mmap(nullptr, _window_size, PROT_READ | PROT_WRITE, flags, _fd,
+                              static_cast<off_t>(_window_offset));
+        if (p == MAP_FAILED)
+          return record(errno, "cannot map file");
+        _window = static_cast<char*>(p);
+#ifdef MADV_HUGEPAGE
+        if (_options._huge_pages)
+          ::madvise(_window, _window_size, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_SEQUENTIAL
+        ::madvise(_window, _window_size, MADV_SEQUENTIAL);
+#endif
+        setp(_window, _window + _window_size);
+        return true;
+      }
+
+    protected:
+      auto overflow(int_type c) -> int_type override
+      {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+          return traits_type::not_eof(c);
+        if (!map_next())
+          return traits_type::eof();
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+        return c;
+      }
+
+      auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+      {
+        auto remaining = static_cast<std::size_t>(n);
+        while (remaining)
+        {
+          if (pptr() == epptr() && !map_next())
+            return n - static_cast<std::streamsize>(remaining);
+          const auto count = std::min(remaining, static_cast<std::size_t>(epptr() - pptr()));
+          std::memcpy(pptr(), s, count);
+          pbump(static_cast<int>(count));
+          s += count;
+          remaining -= count;
+        }
+        return n;
+      }
+
+      // The mapping is shared, so the output is visible to readers of the file already
+      auto sync() -> int override
+      {
+        return 0;
+      }
+
+    public:
+      window_buffer(const std::string& path, const mmap_options& options) : _options(options)
+      {
+        const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        _window_size = std::max(page_size, (options._window_size + page_size - 1) / page_size *
+                                               page_size);
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (_fd < 0)
+          fail(errno, "cannot open " + path);
+      }
+
+      ~window_buffer()
+      {
+        unmap();
+        if (_fd >= 0)
+          ::close(_fd);
+      }
+
+      auto size() const -> std::size_t
+      {
+        return _window_offset + static_cast<std::size_t>(pptr() - pbase());
+      }
+
+      // Truncates the file to the bytes written and reports errors of writing
+      auto close() -> void
+      {
+        if (_fd >= 0)
+        {
+          const auto file_size = size();
+          unmap();
+          const auto fd = _fd;
+          _fd = -1;
+          if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0 && !_error)
+            record(errno, "cannot truncate file");
+          if (::close(fd) != 0 && !_error)
+            record(errno, "cannot close file");
+        }
+        if (_error)
+        {
+          const auto error = _error;
+          _error = 0;
+          fail(error, _what);
+        }
+      }
+    };
+  }
+
+  // Writes a file by rendering directly into a shared memory mapping. The file is extended and
+  // mapped one window at a time and truncated to the exact size by close().
+  class mmap_file_sink
+  {
+    mmap_file_impl::window_buffer _buffer;
+    std::ostream _stream;
+
+  public:
+    explicit mmap_file_sink(const std::string& path, const mmap_options& options = mmap_options{})
+        : _buffer(path, options), _stream(&_buffer)
+    {
+    }
+
+    mmap_file_sink(const mmap_file_sink&) = delete;
+    mmap_file_sink& operator=(const mmap_file_sink&) = delete;
+
+    // Errors are ignored here. Call close() to see them.
+    ~mmap_file_sink()
+    {
+      try
+      {
+        _buffer.close();
+      }
+      catch (...)
+      {
+      }
+    }
+
+    auto stream() -> std::ostream&
+    {
+      return _stream;
+    }
+
+    // Bytes written so far
+    auto size() const -> std::size_t
+    {
+      return _buffer.size();
+    }
+
+    // Throws std::system_error if the file could not be extended (e.g. ENOSPC), mapped, truncated
+    // or closed. Output after such an error is dropped.
+    auto close() -> void
+    {
+      _buffer.close();
+    }
+  };
+}
+
+#endif
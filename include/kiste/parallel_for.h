@@ -0,0 +1,151 @@
+#ifndef KISS_TEMPLATES_KISTE_PARALLEL_FOR_H
+#define KISS_TEMPLATES_KISTE_PARALLEL_FOR_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <kiste/work_stealing_pool.h>
+
+namespace kiste
+{
+  // Controls $parallel_for for a serializer type. Specialize it for serializers that cannot be
+  // constructed from an std::ostream.
+  template <typename Serializer>
+  struct parallel_traits
+  {
+    // Smaller collections are rendered serially
+    static auto threshold() -> std::size_t
+    {
+      return 1024;
+    }
+
+    // The pool that renders the chunks
+    static auto pool() -> work_stealing_pool&
+    {
+      return work_stealing_pool::instance();
+    }
+
+    // Number of elements rendered by each task
+    static auto chunk_size() -> std::size_t
+    {
+      return 256;
+    }
+
+    // A serializer for rendering a chunk into os
+    static auto clone(Serializer&, std::ostream& os) -> Serializer
+    {
+      return Serializer{os};
+    }
+
+    // Appends the output of a chunk to the original serializer
+    static auto splice(Serializer& serialize, const std::string& chunk) -> void
+    {
+      serialize.raw(chunk);
+    }
+  };
+
+  // Called by the code generated for `$parallel_for (declaration : range)`. The body renders the
+  // elements [first, last) with the given serializer. Chunks are rendered into separate buffers
+  // on the work_stealing_pool and appended in order, so the output is the same as with a serial
+  // loop. If a chunk throws, the output of the preceding chunks and the partial output of the
+  // failed one are appended before the exception is rethrown.
+  template <typename Serializer, typename Iterator, typename Body>
+  auto parallel_for(Serializer& serialize, Iterator first, Iterator last, const Body& body) -> void
+  {
+    using traits = parallel_traits<Serializer>;
+    auto& pool = traits::pool();
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    if (pool.size() == 0 || size < traits::threshold() || size <= traits::chunk_size())
+    {
+      body(serialize, first, last);
+      return;
+    }
+
+    const auto chunk_size = traits::chunk_size();
+    const auto chunk_count = (size + chunk_size - 1) / chunk_size;
+    auto outputs = std::vector<std::string>(chunk_count);
+#if KISTE_EXCEPTIONS
+    auto errors = std::vector<std::exception_ptr>(chunk_count);
+#endif
+    std::atomic<std::size_t> remaining(chunk_count);
+
+    auto chunk_first = first;
+    for (std::size_t i = 0; i < chunk_count; ++i)
+    {
+      auto chunk_last = chunk_first;
+      std::advance(chunk_last, i + 1 < chunk_count ? chunk_size : size - i * chunk_size);
+      pool.submit([&, i, chunk_first, chunk_last]
+                  {
+                    std::ostringstream os;
+#if KISTE_EXCEPTIONS
+                    try
+                    {
+                      auto chunk_serializer = traits::clone(serialize, os);
+                      body(chunk_serializer, chunk_first, chunk_last);
+                    }
+                    catch (...)
+                    {
+                      errors[i] = std::current_exception();
+                    }
+#else
+                    {
+                      auto chunk_serializer = traits::clone(serialize, os);
+                      body(chunk_serializer, chunk_first, chunk_last);
+                    }
+#endif
+                    outputs[i] = os.str();
+                    --remaining;
+                  });
+      chunk_first = chunk_last;
+    }
+
+    while (remaining > 0)
+    {
+      if (!pool.run_pending_task())
+        std::this_thread::yield();
+    }
+
+    for (std::size_t i = 0; i < chunk_count; ++i)
+    {
+      traits::splice(serialize, outputs[i]);
+#if KISTE_EXCEPTIONS
+      if (errors[i])
+        std::rethrow_exception(errors[i]);
+#endif
+    }
+  }
+}
+
+#endif
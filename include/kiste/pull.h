@@ -0,0 +1,371 @@
+#ifndef KISS_TEMPLATES_KISTE_PULL_H
+#define KISS_TEMPLATES_KISTE_PULL_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "kiste/pull.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+
+#include <kiste/buffer_stream.h>
+
+namespace kiste
+{
+  // The output of a pull_serializer, which is handed out in chunks of about _chunk_size bytes
+  struct pull_buffer
+  {
+    std::string _text;
+    std::size_t _chunk_size;
+    bool _attached = false;  // known to the pull_task being rendered
+  };
+
+  // Member functions returning pull_task are coroutines. kiste2cpp adds a suspension point after
+  // each line of text, which suspends if the chunk is full. Awaiting a pull_task in another one
+  // (`%co_await child.body();`) renders it into the same chunks.
+  class pull_task
+  {
+  public:
+    struct promise_type
+    {
+      promise_type* _root = this;
+      std::coroutine_handle<promise_type> _current;  // of the root: the innermost task
+      std::coroutine_handle<promise_type> _parent;   // of nested tasks
+      pull_buffer* _buffer = nullptr;                // of the root
+      std::exception_ptr _error;
+
+      auto get_return_object() -> pull_task
+      {
+        return pull_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+
+      auto initial_suspend() noexcept -> std::suspend_always
+      {
+        return {};
+      }
+
+      struct final_awaiter
+      {
+        auto await_ready() noexcept -> bool
+        {
+          return false;
+        }
+
+        auto await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            -> std::coroutine_handle<>
+        {
+          auto& promise = handle.promise();
+          if (promise._parent)
+          {
+            promise._root->_current = promise._parent;
+            return promise._parent;
+          }
+          return std::noop_coroutine();
+        }
+
+        auto await_resume() noexcept -> void
+        {
+        }
+      };
+
+      auto final_suspend() noexcept -> final_awaiter
+      {
+        return {};
+      }
+
+      auto return_void() -> void
+      {
+      }
+
+      auto unhandled_exception() -> void
+      {
+        _error = std::current_exception();
+      }
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+  private:
+    handle_t _handle;
+
+    explicit pull_task(handle_t handle) : _handle(handle)
+    {
+    }
+
+  public:
+    pull_task(pull_task&& rhs) noexcept : _handle(std::exchange(rhs._handle, nullptr))
+    {
+    }
+
+    pull_task& operator=(pull_task&& rhs) noexcept
+    {
+      if (this != &rhs)
+      {
+        if (_handle)
+          _handle.destroy();
+        _handle = std::exchange(rhs._handle, nullptr);
+      }
+      return *this;
+    }
+
+    ~pull_task()
+    {
+      if (_handle)
+        _handle.destroy();
+    }
+
+    auto handle() const -> handle_t
+    {
+      return _handle;
+    }
+
+    struct nested_awaiter
+    {
+      handle_t _handle;
+
+      auto await_ready() noexcept -> bool
+      {
+        return false;
+      }
+
+      auto await_suspend(handle_t parent) noexcept -> std::coroutine_handle<>
+      {
+        auto& promise = _handle.promise();
+        promise._root = parent.promise()._root;
+        promise._parent = parent;
+        promise._root->_current = _handle;
+        return _handle;
+      }
+
+      auto await_resume() -> void
+      {
+        if (_handle.promise()._error)
+          std::rethrow_exception(_handle.promise()._error);
+      }
+    };
+
+    auto operator co_await() && noexcept -> nested_awaiter
+    {
+      return {_handle};
+    }
+  };
+
+  namespace pull_impl
+  {
+    struct chunk_awaiter
+    {
+      pull_buffer& _buffer;
+
+      auto await_ready() noexcept -> bool
+      {
+        return _buffer._attached && _buffer._text.size() < _buffer._chunk_size;
+      }
+
+      auto await_suspend(pull_task::handle_t handle) noexcept -> bool
+      {
+        auto& root = *handle.promise()._root;
+        root._buffer = &_buffer;
+        root._current = handle;
+        _buffer._attached = true;
+        return _buffer._text.size() >= _buffer._chunk_size;
+      }
+
+      auto await_resume() noexcept -> void
+      {
+      }
+    };
+
+    // Constructed before the serializer, which writes to the stream
+    struct pull_storage
+    {
+      pull_buffer _buffer;
+      buffer_stream _stream;
+
+      explicit pull_storage(std::size_t chunk_size)
+          : _buffer{{}, chunk_size ? chunk_size : 1}, _stream(_buffer._text)
+      {
+        _buffer._text.reserve(_buffer._chunk_size);
+      }
+    };
+  }
+
+  // A serializer that writes into chunks for pull()
+  template <typename Serializer>
+  class pull_serializer : private pull_impl::pull_storage, public Serializer
+  {
+  public:
+    explicit pull_serializer(std::size_t chunk_size = 4096)
+        : pull_impl::pull_storage(chunk_size), Serializer(_stream)
+    {
+    }
+
+    pull_serializer(const pull_serializer&) = delete;
+    pull_serializer& operator=(const pull_serializer&) = delete;
+
+    auto pull_point() -> pull_impl::chunk_awaiter
+    {
+      return {_buffer};
+    }
+  };
+
+  // The chunks of a pull_task, e.g. `for (auto chunk : kiste::pull(page.render()))`. The task
+  // renders the next chunk when the consumer asks for it. A chunk is valid until the next one is
+  // requested. Exceptions thrown by the template are passed on to the consumer.
+  class pull_range
+  {
+    pull_task _task;
+    std::string_view _chunk;
+    bool _done = false;
+
+    auto root() -> pull_task::promise_type&
+    {
+      return _task.handle().promise();
+    }
+
+    auto detach() -> void
+    {
+      if (root()._buffer)
+      {
+        root()._buffer->_text.clear();
+        root()._buffer->_attached = false;
+      }
+    }
+
+    auto advance() -> void
+    {
+      auto& promise = root();
+      if (promise._buffer)
+        promise._buffer->_text.clear();
+      if (_task.handle().done())
+      {
+        detach();
+        _done = true;
+        return;
+      }
+      promise._current.resume();
+      if (promise._error)
+      {
+        detach();
+        _done = true;
+        std::rethrow_exception(std::exchange(promise._error, nullptr));
+      }
+      if (promise._buffer && !promise._buffer->_text.empty())
+      {
+        _chunk = promise._buffer->_text;
+      }
+      else
+      {
+        detach();
+        _done = true;
+      }
+    }
+
+  public:
+    class iterator
+    {
+      pull_range* _range;
+
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = std::string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const std::string_view*;
+      using reference = std::string_view;
+
+      explicit iterator(pull_range* range = nullptr) : _range(range)
+      {
+      }
+
+      auto operator*() const -> std::string_view
+      {
+        return _range->_chunk;
+      }
+
+      auto operator++() -> iterator&
+      {
+        _range->advance();
+        return *this;
+      }
+
+      auto operator++(int) -> void
+      {
+        _range->advance();
+      }
+
+      auto at_end() const -> bool
+      {
+        return _range->_done;
+      }
+
+      friend auto operator==(const iterator& it, std::default_sentinel_t) -> bool
+      {
+        return it.at_end();
+      }
+    };
+
+    explicit pull_range(pull_task task) : _task(std::move(task))
+    {
+      root()._current = _task.handle();
+    }
+
+    pull_range(const pull_range&) = delete;
+    pull_range& operator=(const pull_range&) = delete;
+
+    ~pull_range()
+    {
+      if (_task.handle())
+        detach();
+    }
+
+    // Renders the first chunk
+    auto begin() -> iterator
+    {
+      advance();
+      return iterator{this};
+    }
+
+    auto end() const -> std::default_sentinel_t
+    {
+      return {};
+    }
+  };
+
+  inline auto pull(pull_task task) -> pull_range
+  {
+    return pull_range{std::move(task)};
+  }
+}
+
+#endif
@@ -28,19 +28,26 @@
  */
 
 #include <string>
+#include <type_traits>
+#include <utility>
+
+// Every generated header includes this one, so $flush works without an include of its own
+#include <kiste/flush.h>
+#include <kiste/pmr.h>
 
 namespace kiste
 {
   template <typename T>
   struct raw_t
   {
-    // Additionally allow implicit construction from `const char*` if T convertible to std::string
-    raw_t(typename std::enable_if<std::is_convertible<T, std::string>::value, const char*>::type s)
-        : _t(s)
+    // Additionally allow implicit construction from `const char*` for string types
+    template <typename U = T,
+              typename std::enable_if<std::is_convertible<const char*, U>::value>::type* = nullptr>
+    constexpr raw_t(const char* s) : _t(s)
     {
     }
 
-    raw_t(const T& t) : _t(t)
+    constexpr raw_t(const T& t) : _t(t)
     {
     }
 
@@ -64,22 +71,22 @@ namespace kiste
   template <typename T>
   struct conditionally_raw_t
   {
-    // Additionally allow implicit construction from `const char*` if T convertible to std::string
-    conditionally_raw_t(
-        typename std::enable_if<std::is_convertible<T, std::string>::value, const char*>::type s)
-        : _t(s), _is_raw(false)
+    // Additionally allow implicit construction from `const char*` for string types
+    template <typename U = T,
+              typename std::enable_if<std::is_convertible<const char*, U>::value>::type* = nullptr>
+    constexpr conditionally_raw_t(const char* s) : _t(s), _is_raw(false)
     {
     }
 
-    conditionally_raw_t(const T& t) : _t(t), _is_raw(false)
+    constexpr conditionally_raw_t(const T& t) : _t(t), _is_raw(false)
     {
     }
 
-    conditionally_raw_t(const T& t, bool is_raw) : _t(t), _is_raw(is_raw)
+    constexpr conditionally_raw_t(const T& t, bool is_raw) : _t(t), _is_raw(is_raw)
     {
     }
 
-    conditionally_raw_t(const raw_t<T>& r) : _t(r._t), _is_raw(true)
+    constexpr conditionally_raw_t(const raw_t<T>& r) : _t(r._t), _is_raw(true)
     {
     }
 
@@ -90,6 +97,20 @@ namespace kiste
   // Most common use cases
   using conditionally_raw_string = conditionally_raw_t<std::string>;
   using raw_string = raw_t<std::string>;
+
+#if KISTE_PMR
+  // Strings allocated from a memory resource, e.g. an arena that is released after rendering
+  using pmr_conditionally_raw_string = conditionally_raw_t<std::pmr::string>;
+  using pmr_raw_string = raw_t<std::pmr::string>;
+
+  template <typename T>
+  auto rawval(std::pmr::memory_resource* resource, const T& t) -> typename std::enable_if<
+      std::is_convertible<const T&, std::string_view>::value, pmr_raw_string>::type
+  {
+    const auto view = std::string_view(t);
+    return pmr_raw_string(std::pmr::string(view.data(), view.size(), resource));
+  }
+#endif
 }
 
 #endif
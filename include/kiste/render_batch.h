@@ -0,0 +1,333 @@
+#ifndef KISS_TEMPLATES_KISTE_RENDER_BATCH_H
+#define KISS_TEMPLATES_KISTE_RENDER_BATCH_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <kiste/buffer_stream.h>
+#include <kiste/work_stealing_pool.h>
+
+namespace kiste
+{
+  struct batch_options
+  {
+    bool _ordered = true;                 // deliver the outputs in the order of the records
+    std::size_t _max_in_flight = 0;       // outputs waiting for delivery, 0 for 4 per thread
+    work_stealing_pool* _pool = nullptr;  // nullptr for work_stealing_pool::instance()
+  };
+
+  struct batch_statistics
+  {
+    std::size_t _records = 0;
+    std::size_t _bytes = 0;
+    std::size_t _threads = 0;
+    double _seconds = 0;
+
+    auto records_per_second() const -> double
+    {
+      return _seconds > 0 ? static_cast<double>(_records) / _seconds : 0;
+    }
+
+    auto bytes_per_second() const -> double
+    {
+      return _seconds > 0 ? static_cast<double>(_bytes) / _seconds : 0;
+    }
+  };
+
+  namespace render_batch_impl
+  {
+    template <typename Template,
+              typename Iterator,
+              typename SinkFactory,
+              typename SerializerFactory>
+    class batch
+    {
+      using sink_t = typename std::decay<decltype(std::declval<SinkFactory&>()())>::type;
+
+      const Template& _template;
+      const Iterator _first;
+      const std::size_t _count;
+      SinkFactory& _sink_factory;
+      SerializerFactory& _serializer_factory;
+      const bool _ordered;
+      const std::size_t _capacity;
+
+      std::mutex _mutex;
+      std::condition_variable _space;  // signalled when outputs have been delivered
+      std::size_t _next_claim = 0;
+      std::size_t _next_delivery = 0;
+      bool _delivering = false;  // one thread at a time delivers ordered outputs
+      bool _failed = false;
+      std::exception_ptr _error;
+      std::vector<std::string> _slots;  // ordered outputs waiting for delivery
+      std::vector<char> _ready;
+      std::string _output;  // used by the delivering thread
+      std::unique_ptr<sink_t> _sink;  // for ordered outputs
+
+      // Ordered batches hold back records until there is room for their output
+      auto claim(std::size_t& index) -> bool
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _space.wait(lock,
+                    [this]
+                    {
+                      return _failed || _next_claim >= _count || !_ordered ||
+                             _next_claim < _next_delivery + _capacity;
+                    });
+        if (_failed || _next_claim >= _count)
+          return false;
+        index = _next_claim++;
+        return true;
+      }
+
+      auto fail(std::exception_ptr error) -> void
+      {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (!_error)
+            _error = error;
+          _failed = true;
+        }
+        _space.notify_all();
+      }
+
+      auto make_sink() -> std::unique_ptr<sink_t>
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return std::unique_ptr<sink_t>(new sink_t(_sink_factory()));
+      }
+
+      // The buffer receives a previously delivered output for reuse
+      auto complete(std::size_t index, std::string& buffer) -> void
+      {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          const auto slot = index % _capacity;
+          _slots[slot].swap(buffer);
+          _ready[slot] = true;
+          if (_delivering)
+            return;
+          _delivering = true;
+        }
+        deliver();
+      }
+
+      auto deliver() -> void
+      {
+        while (true)
+        {
+          auto index = std::size_t{};
+          {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto slot = _next_delivery % _capacity;
+            if (_failed || _next_delivery >= _count || !_ready[slot])
+            {
+              _delivering = false;
+              return;
+            }
+            _slots[slot].swap(_output);
+            _ready[slot] = false;
+            index = _next_delivery++;
+          }
+          _space.notify_all();
+          (*_sink)(index, static_cast<const std::string&>(_output));
+        }
+      }
+
+      auto render(std::size_t index, std::string& buffer) -> void
+      {
+        buffer_stream stream(buffer);
+        auto serializer = _serializer_factory(stream);
+        auto own_sink = std::unique_ptr<sink_t>{};
+        do
+        {
+          buffer.clear();
+          _template(*(_first + static_cast<std::ptrdiff_t>(index)), serializer).render();
+          _bytes += buffer.size();
+          ++_records;
+          if (_ordered)
+          {
+            complete(index, buffer);
+          }
+          else
+          {
+            if (!own_sink)
+              own_sink = make_sink();
+            (*own_sink)(index, static_cast<const std::string&>(buffer));
+          }
+        } while (claim(index));
+      }
+
+    public:
+      std::atomic<std::size_t> _bytes;
+      std::atomic<std::size_t> _records;
+      std::atomic<std::size_t> _active_workers;
+      std::atomic<std::size_t> _threads;
+
+      batch(const Template& t,
+            Iterator first,
+            std::size_t count,
+            SinkFactory& sink_factory,
+            SerializerFactory& serializer_factory,
+            const batch_options& options,
+            std::size_t thread_count)
+          : _template(t),
+            _first(first),
+            _count(count),
+            _sink_factory(sink_factory),
+            _serializer_factory(serializer_factory),
+            _ordered(options._ordered),
+            _capacity(options._max_in_flight ? options._max_in_flight : 4 * thread_count),
+            _bytes(0),
+            _records(0),
+            _active_workers(0),
+            _threads(0)
+      {
+        if (_ordered)
+        {
+          _slots.resize(_capacity);
+          _ready.resize(_capacity);
+          _sink = make_sink();
+        }
+      }
+
+      batch(const batch&) = delete;
+      batch& operator=(const batch&) = delete;
+
+      // Renders records until there are none left. Each worker keeps its serializer and buffer.
+      auto work() -> void
+      {
+        auto index = std::size_t{};
+        if (!claim(index))
+          return;
+        ++_threads;
+        auto buffer = std::string{};
+#if KISTE_EXCEPTIONS
+        try
+        {
+          render(index, buffer);
+        }
+        catch (...)
+        {
+          fail(std::current_exception());
+        }
+#else
+        render(index, buffer);
+#endif
+      }
+
+      auto rethrow_error() -> void
+      {
+#if KISTE_EXCEPTIONS
+        if (_error)
+          std::rethrow_exception(_error);
+#endif
+      }
+    };
+  }
+
+  // Renders `template_factory(record, serializer).render()` for each record of a random access
+  // range on a work_stealing_pool. Workers claim records one by one and reuse their serializer
+  // and buffer.
+  //
+  //   - `sink_factory()` creates a sink, which is called as `sink(index, output)`.
+  //   - `serializer_factory(stream)` creates a serializer writing to the ostream `stream`.
+  //
+  // Ordered batches deliver all outputs to a single sink in the order of the records. At most
+  // _max_in_flight outputs wait for their predecessors, which bounds the memory. Unordered batches
+  // create a sink per worker, which gets the outputs as soon as they are rendered.
+  //
+  // If a record or a sink throws, no further records are rendered and the exception is rethrown.
+  template <typename Template, typename Range, typename SinkFactory, typename SerializerFactory>
+  auto render_batch(const Template& template_factory,
+                    const Range& records,
+                    SinkFactory sink_factory,
+                    SerializerFactory serializer_factory,
+                    const batch_options& options = batch_options{}) -> batch_statistics
+  {
+    using std::begin;
+    using std::end;
+    using iterator_t = decltype(begin(records));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto& pool = options._pool ? *options._pool : work_stealing_pool::instance();
+    const auto count = static_cast<std::size_t>(std::distance(begin(records), end(records)));
+    render_batch_impl::batch<Template, iterator_t, SinkFactory, SerializerFactory> b(
+        template_factory, begin(records), count, sink_factory, serializer_factory, options,
+        pool.size() + 1);
+
+    for (std::size_t i = 0; i < pool.size() && i + 1 < count; ++i)
+    {
+      ++b._active_workers;
+      pool.submit([&b]
+                  {
+                    b.work();
+                    --b._active_workers;
+                  });
+    }
+    b.work();
+    while (b._active_workers > 0)
+    {
+      if (!pool.run_pending_task())
+        std::this_thread::yield();
+    }
+    b.rethrow_error();
+
+    auto statistics = batch_statistics{};
+    statistics._records = b._records;
+    statistics._bytes = b._bytes;
+    statistics._threads = b._threads;
+    statistics._seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return statistics;
+  }
+
+  // For serializers that are constructed from an ostream, e.g. render_batch<kiste::html>(...)
+  template <typename Serializer, typename Template, typename Range, typename SinkFactory>
+  auto render_batch(const Template& template_factory,
+                    const Range& records,
+                    SinkFactory sink_factory,
+                    const batch_options& options = batch_options{}) -> batch_statistics
+  {
+    return render_batch(template_factory, records, sink_factory,
+                        [](std::ostream& os) { return Serializer{os}; }, options);
+  }
+}
+
+#endif
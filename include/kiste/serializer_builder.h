@@ -33,6 +33,26 @@ namespace kiste
 {
   namespace serializer_impl
   {
+#if defined(__cpp_variadic_using) && __cpp_variadic_using >= 201611
+    // All escape functions of all policies form a single overload set
+    template <typename... Policies>
+    struct serializer : Policies...
+    {
+      serializer(Policies&&... policies) : Policies(std::forward<Policies>(policies))...
+      {
+      }
+
+      template <typename T>
+      void escape(const T& t)
+      {
+        escape(*this, t);
+      }
+
+      using Policies::escape...;
+    };
+#else
+    // Without pack expansion in using-declarations, each level of the chain adds the escape
+    // functions of one policy to the overload set
     template <typename... Policies>
     struct serializer_base;
 
@@ -76,6 +96,7 @@ namespace kiste
 
       using serializer_base<Policies...>::escape;
     };
+#endif
   }
 
   template <typename... Policies>
@@ -0,0 +1,209 @@
+#ifndef KISS_TEMPLATES_KISTE_SERIALIZER_POOL_H
+#define KISS_TEMPLATES_KISTE_SERIALIZER_POOL_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <kiste/buffer_stream.h>
+#include <kiste/flush.h>
+
+namespace kiste
+{
+  struct pool_options
+  {
+    std::size_t _initial_capacity = 1 << 16;   // of new buffers
+    std::size_t _max_capacity = 1 << 20;       // larger buffers are shrunk when returned
+    std::size_t _max_pooled = 16;              // serializers kept per thread
+    std::size_t _max_retained = 16 << 20;      // buffer capacity kept per thread
+  };
+
+  // Hands out serializers together with a stream and an output buffer, which are returned to the
+  // pool when the handle is destroyed. Returned pairs are kept in free lists per thread and per
+  // pool, so acquiring and returning them takes no locks and usually no allocations. The pool has
+  // to outlive its handles.
+  template <typename Serializer>
+  class serializer_pool
+  {
+    struct entry
+    {
+      std::string _buffer;
+      buffer_stream _stream;
+      Serializer _serializer;
+
+      explicit entry(std::size_t capacity) : _stream(_buffer), _serializer(_stream)
+      {
+        _buffer.reserve(capacity);
+      }
+    };
+
+    struct free_list
+    {
+      std::weak_ptr<void> _pool;  // see _id
+      std::vector<std::unique_ptr<entry>> _entries;
+      std::size_t _retained = 0;  // buffer capacity
+    };
+
+    pool_options _options;
+    // Identifies the free lists of this pool. They expire with the pool and are dropped once the
+    // thread uses another pool (or ends), so a new pool never inherits them.
+    std::shared_ptr<void> _id = std::make_shared<char>();
+
+    auto local_free_list() const -> free_list&
+    {
+      static thread_local std::vector<free_list> lists;
+      for (auto& list : lists)
+      {
+        if (!list._pool.owner_before(_id) && !_id.owner_before(list._pool))
+          return list;
+      }
+      lists.erase(std::remove_if(lists.begin(),
+                                 lists.end(),
+                                 [](const free_list& list) { return list._pool.expired(); }),
+                  lists.end());
+      lists.emplace_back();
+      lists.back()._pool = _id;
+      return lists.back();
+    }
+
+    auto release(std::unique_ptr<entry> e) -> void
+    {
+      kiste::flush(e->_serializer);
+      e->_buffer.clear();
+      e->_stream.clear();
+      if (e->_buffer.capacity() > _options._max_capacity)
+      {
+        std::string{}.swap(e->_buffer);
+        e->_buffer.reserve(_options._initial_capacity);
+        e->_buffer.clear();  // buffered serializers might have written while flushing
+      }
+      auto& list = local_free_list();
+      const auto capacity = e->_buffer.capacity();
+      if (list._entries.size() < _options._max_pooled &&
+          list._retained + capacity <= _options._max_retained)
+      {
+        list._retained += capacity;
+        list._entries.push_back(std::move(e));
+      }
+    }
+
+  public:
+    class handle
+    {
+      serializer_pool* _pool = nullptr;
+      std::unique_ptr<entry> _entry;
+
+      friend class serializer_pool;
+
+      handle(serializer_pool* pool, std::unique_ptr<entry> e) : _pool(pool), _entry(std::move(e))
+      {
+      }
+
+    public:
+      handle() = default;
+      handle(handle&&) = default;
+
+      handle& operator=(handle&& rhs)
+      {
+        if (this != &rhs)
+        {
+          reset();
+          _pool = rhs._pool;
+          _entry = std::move(rhs._entry);
+        }
+        return *this;
+      }
+
+      ~handle()
+      {
+        reset();
+      }
+
+      // Returns the serializer and its buffer to the pool
+      auto reset() -> void
+      {
+        if (_entry)
+          _pool->release(std::move(_entry));
+      }
+
+      explicit operator bool() const
+      {
+        return static_cast<bool>(_entry);
+      }
+
+      auto serializer() -> Serializer&
+      {
+        return _entry->_serializer;
+      }
+
+      auto stream() -> std::ostream&
+      {
+        return _entry->_stream;
+      }
+
+      // The output so far, after flushing buffered serializers
+      auto output() -> std::string&
+      {
+        kiste::flush(_entry->_serializer);
+        return _entry->_buffer;
+      }
+    };
+
+    explicit serializer_pool(const pool_options& options = pool_options{}) : _options(options)
+    {
+    }
+
+    serializer_pool(const serializer_pool&) = delete;
+    serializer_pool& operator=(const serializer_pool&) = delete;
+
+    // A serializer writing into an empty buffer
+    auto acquire() -> handle
+    {
+      auto& list = local_free_list();
+      if (list._entries.empty())
+        return handle{this, std::unique_ptr<entry>(new entry(_options._initial_capacity))};
+      auto e = std::move(list._entries.back());
+      list._entries.pop_back();
+      list._retained -= e->_buffer.capacity();
+      return handle{this, std::move(e)};
+    }
+
+    // Serializers waiting in the free list of this thread
+    auto pooled() const -> std::size_t
+    {
+      return local_free_list()._entries.size();
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef KISS_TEMPLATES_KISTE_SLOTS_H
+#define KISS_TEMPLATES_KISTE_SLOTS_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include <kiste/buffer_stream.h>
+
+namespace kiste
+{
+  // Output with named slots that are filled later, e.g. by other threads. The template renders
+  // straight through and leaves a placeholder for each $slot{name}. Everything up to the first
+  // unfilled slot is passed to the sink right away, only the bytes behind it are held back until
+  // the slot has been filled.
+  //
+  // The body is written by one thread (via stream(), slot(), flush() and finish()), slots may be
+  // filled from any thread. The sink is called in order and never concurrently.
+  class slotted_output
+  {
+  public:
+    using sink_t = std::function<void(const char*, std::size_t)>;
+
+  private:
+    struct segment
+    {
+      bool _is_slot;
+      std::string _text;  // the name for slots
+    };
+
+    sink_t _sink;
+    std::mutex _mutex;
+    std::condition_variable _flushed;
+    std::deque<segment> _segments;  // not yet passed to the sink, the last one is open while _open
+    std::map<std::string, std::string> _contents;  // of filled slots
+    bool _open = true;
+    bool _flushing = false;  // one thread at a time calls the sink
+    string_appender _appender;
+    std::ostream _stream;
+
+    auto is_open(const segment& s) const -> bool
+    {
+      return _open && &s == &_segments.back();
+    }
+
+    // The body continues in a new segment, requires the lock
+    auto open_segment() -> void
+    {
+      _segments.push_back(segment{false, {}});
+      _appender.set_target(_segments.back()._text);
+    }
+
+    // The open segment is written without locking, so only the body's thread may take it
+    auto flush_segments(bool take_open) -> void
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (_flushing)
+      {
+        // The flushing thread cannot take the open segment, since the body might write to it. So
+        // the body continues in a new segment and the flushing thread passes on the old one.
+        if (take_open && _open && !_segments.back()._text.empty())
+          open_segment();
+        return;
+      }
+      _flushing = true;
+      auto chunk = std::string{};
+      while (true)
+      {
+        while (!_segments.empty())
+        {
+          auto& front = _segments.front();
+          if (front._is_slot)
+          {
+            const auto it = _contents.find(front._text);
+            if (it == _contents.end())
+              break;
+            chunk += it->second;
+          }
+          else if (is_open(front))
+          {
+            if (take_open)
+            {
+              chunk += front._text;
+              front._text.clear();
+            }
+            break;
+          }
+          else
+          {
+            chunk += front._text;
+          }
+          _segments.pop_front();
+        }
+        if (chunk.empty())
+          break;
+        lock.unlock();
+        try
+        {
+          _sink(chunk.data(), chunk.size());
+        }
+        catch (...)
+        {
+          lock.lock();
+          _flushing = false;
+          _flushed.notify_all();
+          throw;
+        }
+        chunk.clear();
+        take_open = false;  // the body's thread might be writing again by now
+        lock.lock();
+      }
+      _flushing = false;
+      _flushed.notify_all();
+    }
+
+  public:
+    explicit slotted_output(sink_t sink) : _sink(std::move(sink)), _stream(nullptr)
+    {
+      open_segment();
+      _stream.rdbuf(&_appender);
+    }
+
+    slotted_output(const slotted_output&) = delete;
+    slotted_output& operator=(const slotted_output&) = delete;
+
+    // The stream for the body
+    auto stream() -> std::ostream&
+    {
+      return _stream;
+    }
+
+    // Leaves a placeholder for the named slot in the body
+    auto slot(const std::string& name) -> void
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _segments.push_back(segment{true, name});
+        open_segment();
+      }
+      flush_segments(true);
+    }
+
+    // Sets the content of the named slot, before or after its placeholder has been written.
+    // Every placeholder with that name receives the same content.
+    auto fill(const std::string& name, std::string content) -> void
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _contents.emplace(name, std::move(content));
+      }
+      flush_segments(false);
+    }
+
+    // Passes the body written so far to the sink unless it is held back by a slot
+    auto flush() -> void
+    {
+      flush_segments(true);
+    }
+
+    // The body is complete
+    auto finish() -> void
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _open = false;
+      }
+      flush_segments(true);
+    }
+
+    // Blocks until finish() has been called and all slots have been filled and passed on
+    auto wait() -> void
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _flushed.wait(lock, [this] { return !_open && !_flushing && _segments.empty(); });
+    }
+
+    // The number of placeholders still waiting for their content
+    auto unfilled_slots() -> std::size_t
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto count = std::size_t{0};
+      for (const auto& s : _segments)
+      {
+        if (s._is_slot && _contents.find(s._text) == _contents.end())
+          ++count;
+      }
+      return count;
+    }
+  };
+
+  // A serializer writing the body of a slotted_output, adding slot() for $slot{name}
+  template <typename Serializer>
+  class slot_serializer : public Serializer
+  {
+    slotted_output& _output;
+
+  public:
+    explicit slot_serializer(slotted_output& output) : Serializer(output.stream()), _output(output)
+    {
+    }
+
+    auto slot(const std::string& name) -> void
+    {
+      _output.slot(name);
+    }
+
+    auto flush() -> void
+    {
+      _output.flush();
+    }
+  };
+
+  // Renders a template into the named slot, e.g. on another thread
+  template <typename Serializer, typename Template, typename Data>
+  auto render_slot(slotted_output& output,
+                   const std::string& name,
+                   const Template& templ,
+                   const Data& data) -> void
+  {
+    auto content = std::string{};
+    {
+      buffer_stream os(content);
+      Serializer serializer(os);
+      templ(data, serializer).render();
+    }
+    output.fill(name, std::move(content));
+  }
+}
+
+#endif
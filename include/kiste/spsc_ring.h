@@ -0,0 +1,326 @@
+#ifndef KISS_TEMPLATES_KISTE_SPSC_RING_H
+#define KISS_TEMPLATES_KISTE_SPSC_RING_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace kiste
+{
+  struct ring_span
+  {
+    char* _data;
+    std::size_t _size;
+  };
+
+  // A lock-free byte ring for one producer (e.g. a render thread) and one consumer (e.g. an I/O
+  // thread). The producer writes into writable() and publishes with commit(), the consumer reads
+  // readable() (e.g. with writev) and releases with consume().
+  class spsc_ring
+  {
+    static constexpr std::size_t cache_line = 64;
+
+    // Each side's index and its cached copy of the other index share a cache line
+    struct alignas(cache_line) producer_t
+    {
+      std::atomic<std::size_t> _head{0};  // bytes committed so far
+      std::size_t _cached_tail = 0;
+      std::atomic<bool> _closed{false};
+    };
+
+    struct alignas(cache_line) consumer_t
+    {
+      std::atomic<std::size_t> _tail{0};  // bytes consumed so far
+      std::size_t _cached_head = 0;
+    };
+
+    producer_t _producer;
+    consumer_t _consumer;
+    const std::size_t _capacity;
+    std::unique_ptr<char[]> _storage;
+    char* _buffer;
+
+    static auto round_up(std::size_t capacity) -> std::size_t
+    {
+      auto result = std::size_t{cache_line};
+      while (result < capacity)
+        result *= 2;
+      return result;
+    }
+
+  public:
+    // The capacity is rounded up to a power of two
+    explicit spsc_ring(std::size_t capacity = 1 << 16)
+        : _capacity(round_up(capacity)), _storage(new char[_capacity + cache_line - 1])
+    {
+      auto space = _capacity + cache_line - 1;
+      void* p = _storage.get();
+      _buffer = static_cast<char*>(std::align(cache_line, _capacity, p, space));
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    auto capacity() const -> std::size_t
+    {
+      return _capacity;
+    }
+
+    // Producer: the free space up to the end of the buffer, empty if the ring is full
+    auto writable() -> ring_span
+    {
+      const auto head = _producer._head.load(std::memory_order_relaxed);
+      if (head - _producer._cached_tail == _capacity)
+        _producer._cached_tail = _consumer._tail.load(std::memory_order_acquire);
+      const auto offset = head & (_capacity - 1);
+      const auto free = _capacity - (head - _producer._cached_tail);
+      return {_buffer + offset, std::min(free, _capacity - offset)};
+    }
+
+    // Producer: publishes bytes written into writable()
+    auto commit(std::size_t size) -> void
+    {
+      _producer._head.store(_producer._head.load(std::memory_order_relaxed) + size,
+                            std::memory_order_release);
+    }
+
+    // Producer: no more bytes will be committed
+    auto close() -> void
+    {
+      _producer._closed.store(true, std::memory_order_release);
+    }
+
+    // Consumer: the committed bytes, in up to two spans (the second one if they wrap around)
+    auto readable() -> std::array<ring_span, 2>
+    {
+      const auto tail = _consumer._tail.load(std::memory_order_relaxed);
+      if (_consumer._cached_head == tail)
+        _consumer._cached_head = _producer._head.load(std::memory_order_acquire);
+      const auto offset = tail & (_capacity - 1);
+      const auto available = _consumer._cached_head - tail;
+      const auto first = std::min(available, _capacity - offset);
+      return {{{_buffer + offset, first}, {_buffer, available - first}}};
+    }
+
+    // Consumer: releases bytes returned by readable()
+    auto consume(std::size_t size) -> void
+    {
+      _consumer._tail.store(_consumer._tail.load(std::memory_order_relaxed) + size,
+                            std::memory_order_release);
+    }
+
+    // Consumer: the producer has closed the ring and everything has been consumed
+    auto done() -> bool
+    {
+      return _producer._closed.load(std::memory_order_acquire) &&
+             _consumer._tail.load(std::memory_order_relaxed) ==
+                 _producer._head.load(std::memory_order_acquire);
+    }
+  };
+
+  enum class ring_full_policy
+  {
+    wait,   // until the consumer has made room
+    spill,  // into a buffer of the producer, which is moved into the ring later
+  };
+
+  namespace spsc_ring_impl
+  {
+    // The put area is the free space of the ring, so the serializer writes directly into it
+    class ring_buffer : public std::streambuf
+    {
+      spsc_ring& _ring;
+      const ring_full_policy _policy;
+      std::string _spill;  // output that did not fit into the ring, in order
+      std::size_t _spill_pos = 0;
+
+      auto commit() -> void
+      {
+        if (pptr() != pbase())
+          _ring.commit(static_cast<std::size_t>(pptr() - pbase()));
+        setp(nullptr, nullptr);
+      }
+
+      // Moves spilled output into the ring, returns true if nothing is left
+      auto drain_spill() -> bool
+      {
+        while (_spill_pos < _spill.size())
+        {
+          const auto span = _ring.writable();
+          if (span._size == 0)
+            return false;
+          const auto count = std::min(span._size, _spill.size() - _spill_pos);
+          std::memcpy(span._data, _spill.data() + _spill_pos, count);
+          _ring.commit(count);
+          _spill_pos += count;
+        }
+        _spill.clear();
+        _spill_pos = 0;
+        return true;
+      }
+
+      // Opens the next free space of the ring as put area, false if the output has to spill
+      auto open() -> bool
+      {
+        commit();
+        if (!drain_spill())
+        {
+          if (_policy == ring_full_policy::spill)
+            return false;
+          while (!drain_spill())
+            std::this_thread::yield();
+        }
+        auto span = _ring.writable();
+        while (span._size == 0)
+        {
+          if (_policy == ring_full_policy::spill)
+            return false;
+          std::this_thread::yield();
+          span = _ring.writable();
+        }
+        setp(span._data, span._data + span._size);
+        return true;
+      }
+
+    protected:
+      auto overflow(int_type c) -> int_type override
+      {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+          return traits_type::not_eof(c);
+        if (open())
+        {
+          *pptr() = traits_type::to_char_type(c);
+          pbump(1);
+        }
+        else
+        {
+          _spill.push_back(traits_type::to_char_type(c));
+        }
+        return c;
+      }
+
+      auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+      {
+        auto remaining = static_cast<std::size_t>(n);
+        while (remaining)
+        {
+          if (pptr() == epptr() && !open())
+          {
+            _spill.append(s, remaining);
+            break;
+          }
+          const auto count = std::min(remaining, static_cast<std::size_t>(epptr() - pptr()));
+          std::memcpy(pptr(), s, count);
+          pbump(static_cast<int>(count));
+          s += count;
+          remaining -= count;
+        }
+        return n;
+      }
+
+      // Publishes the output written so far
+      auto sync() -> int override
+      {
+        commit();
+        drain_spill();
+        return 0;
+      }
+
+    public:
+      ring_buffer(spsc_ring& ring, ring_full_policy policy) : _ring(ring), _policy(policy)
+      {
+      }
+
+      auto spilled() const -> std::size_t
+      {
+        return _spill.size() - _spill_pos;
+      }
+
+      // Waits until all output is in the ring and closes it
+      auto close() -> void
+      {
+        commit();
+        while (!drain_spill())
+          std::this_thread::yield();
+        _ring.close();
+      }
+    };
+  }
+
+  // The producer side of an spsc_ring for serializers, e.g. `kiste::html{sink.stream()}`.
+  // Output becomes visible to the consumer when the stream is flushed (e.g. by $flush), when the
+  // free space at the end of the ring is used up, and when the sink is closed.
+  class spsc_ring_sink
+  {
+    spsc_ring_impl::ring_buffer _buffer;
+    std::ostream _stream;
+
+  public:
+    explicit spsc_ring_sink(spsc_ring& ring, ring_full_policy policy = ring_full_policy::wait)
+        : _buffer(ring, policy), _stream(&_buffer)
+    {
+    }
+
+    spsc_ring_sink(const spsc_ring_sink&) = delete;
+    spsc_ring_sink& operator=(const spsc_ring_sink&) = delete;
+
+    auto stream() -> std::ostream&
+    {
+      return _stream;
+    }
+
+    // Publishes the output written so far, moves as much spilled output into the ring as fits
+    auto flush() -> void
+    {
+      _buffer.pubsync();
+    }
+
+    // Bytes waiting for room in the ring
+    auto spilled() const -> std::size_t
+    {
+      return _buffer.spilled();
+    }
+
+    // Waits until all output is in the ring, then closes it
+    auto close() -> void
+    {
+      _buffer.close();
+    }
+  };
+}
+
+#endif
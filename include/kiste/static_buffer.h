@@ -0,0 +1,256 @@
+#ifndef KISS_TEMPLATES_KISTE_STATIC_BUFFER_H
+#define KISS_TEMPLATES_KISTE_STATIC_BUFFER_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include <kiste/raw_type.h>
+
+#if !defined(__cpp_constexpr) || __cpp_constexpr < 201907L || \
+    !defined(__cpp_nontype_template_args) || __cpp_nontype_template_args < 201911L
+#error "kiste/static_buffer.h requires C++20"
+#endif
+
+namespace kiste
+{
+  namespace static_buffer_impl
+  {
+    // Serializes like kiste::html, but all in constant evaluation.
+    // Derived classes decide what to do with each character by providing `put(char)`.
+    template <typename Derived>
+    class html_writer
+    {
+      constexpr auto put(char c) -> void
+      {
+        static_cast<Derived&>(*this).put(c);
+      }
+
+      constexpr auto put(std::string_view s) -> void
+      {
+        for (const auto c : s)
+          put(c);
+      }
+
+      template <typename T>
+      constexpr auto put_integral(const T& t) -> void
+      {
+        using unsigned_t = std::make_unsigned_t<T>;
+        auto value = static_cast<unsigned_t>(t);
+        if constexpr (std::is_signed_v<T>)
+        {
+          if (t < 0)
+          {
+            put('-');
+            value = static_cast<unsigned_t>(unsigned_t{0} - value);
+          }
+        }
+        char digits[3 * sizeof(T)] = {};
+        auto count = std::size_t{0};
+        do
+        {
+          digits[count++] = static_cast<char>('0' + value % 10);
+          value /= 10;
+        } while (value);
+        while (count)
+          put(digits[--count]);
+      }
+
+    public:
+      constexpr auto text(const char* text) -> void
+      {
+        put(std::string_view(text));
+      }
+
+      constexpr auto escape(const char& c) -> void
+      {
+        switch (c)
+        {
+        case '<':
+          put("&lt;");
+          break;
+        case '>':
+          put("&gt;");
+          break;
+        case '\'':
+          put("&#39;");
+          break;
+        case '"':
+          put("&quot;");
+          break;
+        case '&':
+          put("&amp;");
+          break;
+        default:
+          put(c);
+        }
+      }
+
+      constexpr auto escape(const bool& b) -> void
+      {
+        put(b ? '1' : '0');
+      }
+
+      template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+      constexpr auto escape(const T& t) -> void
+      {
+        put_integral(t);
+      }
+
+      template <typename T,
+                typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+      constexpr auto escape(const T&) -> void
+      {
+        static_assert(!std::is_floating_point<T>::value,
+                      "kiste::static_buffer cannot serialize floating point numbers");
+      }
+
+      template <typename T>
+      constexpr auto escape(const raw_t<T>& r) -> void
+      {
+        raw(r._t);
+      }
+
+      template <typename T>
+      constexpr auto escape(const conditionally_raw_t<T>& cr) -> void
+      {
+        if (cr._is_raw)
+          raw(cr._t);
+        else
+          escape(cr._t);
+      }
+
+      template <typename T,
+                typename std::enable_if<std::is_convertible<T, std::string_view>::value>::type* =
+                    nullptr>
+      constexpr auto escape(const T& t) -> void
+      {
+        for (const auto c : std::string_view(t))
+          escape(c);
+      }
+
+      template <typename T>
+      constexpr auto raw(const T& t) -> void
+      {
+        if constexpr (std::is_integral<T>::value && !std::is_same<T, char>::value)
+          put_integral(t);
+        else if constexpr (std::is_same<T, char>::value)
+          put(t);
+        else
+          put(std::string_view(t));
+      }
+    };
+  }
+
+  // Counts the characters a template would write, see render_static()
+  class static_size : public static_buffer_impl::html_writer<static_size>
+  {
+    friend class static_buffer_impl::html_writer<static_size>;
+    std::size_t _size = 0;
+
+    constexpr auto put(char) -> void
+    {
+      ++_size;
+    }
+
+  public:
+    constexpr auto size() const -> std::size_t
+    {
+      return _size;
+    }
+  };
+
+  // Serializer writing into a fixed size array. It can be used in constant evaluation, e.g.
+  //
+  //   constexpr auto page = kiste::render_static<ErrorPage, not_found>();
+  //
+  // Running out of space throws std::length_error, which turns into a compile error when it happens
+  // in constant evaluation.
+  template <std::size_t N>
+  class static_buffer : public static_buffer_impl::html_writer<static_buffer<N>>
+  {
+    friend class static_buffer_impl::html_writer<static_buffer<N>>;
+    std::array<char, N> _data = {};
+    std::size_t _size = 0;
+
+    constexpr auto put(char c) -> void
+    {
+      if (_size == N)
+        throw std::length_error("kiste::static_buffer is too small");
+      _data[_size++] = c;
+    }
+
+  public:
+    constexpr auto data() const -> const char*
+    {
+      return _data.data();
+    }
+
+    constexpr auto size() const -> std::size_t
+    {
+      return _size;
+    }
+
+    constexpr auto view() const -> std::string_view
+    {
+      return {_data.data(), _size};
+    }
+
+    constexpr operator std::string_view() const
+    {
+      return view();
+    }
+  };
+
+  // Renders a template into a buffer of the given capacity.
+  // The template's functions need to be constexpr, e.g. `%constexpr auto render() -> void`.
+  template <std::size_t N, typename Template, typename Data>
+  constexpr auto render_static(const Template& t, const Data& data) -> static_buffer<N>
+  {
+    auto buffer = static_buffer<N>{};
+    t(data, buffer).render();
+    return buffer;
+  }
+
+  // Renders a template with constant data into a buffer of exactly the required size.
+  template <const auto& Template, const auto& Data>
+  constexpr auto render_static()
+  {
+    constexpr auto size = [] {
+      auto counter = static_size{};
+      Template(Data, counter).render();
+      return counter.size();
+    }();
+    return render_static<size>(Template, Data);
+  }
+}
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef KISS_TEMPLATES_KISTE_URING_SINK_H
+#define KISS_TEMPLATES_KISTE_URING_SINK_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(__linux__)
+#error "kiste/uring_sink.h requires Linux"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <system_error>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define KISTE_IO_URING 1
+#endif
+#endif
+#ifndef KISTE_IO_URING
+#define KISTE_IO_URING 0
+#endif
+
+namespace kiste
+{
+  namespace uring_impl
+  {
+    struct sink_state
+    {
+      int _fd;
+      std::int64_t _offset;  // -1 for pipes and sockets
+      std::size_t _in_flight = 0;
+      int _error = 0;
+
+      sink_state(int fd, std::int64_t offset) : _fd(fd), _offset(offset)
+      {
+      }
+    };
+
+    struct buffer_t
+    {
+      char* _data;
+      std::size_t _size = 0;     // filled by the sink
+      std::size_t _written = 0;  // by completed writes
+      std::int64_t _offset = -1;
+      sink_state* _owner = nullptr;
+
+      explicit buffer_t(char* data) : _data(data)
+      {
+      }
+    };
+
+    // Writes synchronously, used if io_uring is not available
+    inline auto write_all(int fd, const char* data, std::size_t size, std::int64_t offset) -> int
+    {
+      while (size)
+      {
+        const auto result = offset < 0 ? ::write(fd, data, size)
+                                       : ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (result < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return errno;
+        }
+        data += result;
+        size -= static_cast<std::size_t>(result);
+        if (offset >= 0)
+          offset += result;
+      }
+      return 0;
+    }
+
+#if KISTE_IO_URING
+    // Just enough of io_uring for writes, using the system calls directly (no liburing)
+    class ring
+    {
+      int _fd = -1;
+      void* _sq_ptr = MAP_FAILED;
+      std::size_t _sq_size = 0;
+      void* _cq_ptr = MAP_FAILED;
+      std::size_t _cq_size = 0;
+      io_uring_sqe* _sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+      std::size_t _sqes_size = 0;
+      unsigned* _sq_tail = nullptr;
+      unsigned _sq_mask = 0;
+      unsigned* _sq_array = nullptr;
+      unsigned* _cq_head = nullptr;
+      unsigned* _cq_tail = nullptr;
+      unsigned _cq_mask = 0;
+      io_uring_cqe* _cqes = nullptr;
+
+      static auto map(int fd, std::size_t size, std::uint64_t offset) -> void*
+      {
+        return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      static_cast<off_t>(offset));
+      }
+
+      template <typename T>
+      static auto at(void* base, std::uint32_t offset) -> T*
+      {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+      }
+
+    public:
+      ring() = default;
+      ring(const ring&) = delete;
+      ring& operator=(const ring&) = delete;
+
+      ~ring()
+      {
+        if (_sqes != MAP_FAILED)
+          ::munmap(_sqes, _sqes_size);
+        if (_cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr)
+          ::munmap(_cq_ptr, _cq_size);
+        if (_sq_ptr != MAP_FAILED)
+          ::munmap(_sq_ptr, _sq_size);
+        if (_fd >= 0)
+          ::close(_fd);
+      }
+
+      auto open(unsigned entries) -> bool
+      {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        _fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (_fd < 0)
+          return false;
+
+        _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+          _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+        _sq_ptr = map(_fd, _sq_size, IORING_OFF_SQ_RING);
+        if (_sq_ptr == MAP_FAILED)
+          return false;
+        _cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP)
+                      ? _sq_ptr
+                      : map(_fd, _cq_size, IORING_OFF_CQ_RING);
+        if (_cq_ptr == MAP_FAILED)
+          return false;
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe*>(map(_fd, _sqes_size, IORING_OFF_SQES));
+        if (_sqes == MAP_FAILED)
+          return false;
+
+        _sq_tail = at<unsigned>(_sq_ptr, params.sq_off.tail);
+        _sq_mask = *at<unsigned>(_sq_ptr, params.sq_off.ring_mask);
+        _sq_array = at<unsigned>(_sq_ptr, params.sq_off.array);
+        _cq_head = at<unsigned>(_cq_ptr, params.cq_off.head);
+        _cq_tail = at<unsigned>(_cq_ptr, params.cq_off.tail);
+        _cq_mask = *at<unsigned>(_cq_ptr, params.cq_off.ring_mask);
+        _cqes = at<io_uring_cqe>(_cq_ptr, params.cq_off.cqes);
+        return true;
+      }
+
+      auto register_buffers(const iovec* buffers, unsigned count) -> bool
+      {
+        return ::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, buffers, count) ==
+               0;
+      }
+
+      // Kernels before 5.6 have io_uring, but neither IORING_OP_WRITE nor probing for it
+      auto supports(unsigned opcode) -> bool
+      {
+        constexpr auto op_count = 256u;
+        // The header of the probe has the size of two ops
+        auto storage = std::vector<io_uring_probe_op>(op_count + 2);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PROBE, probe, op_count) != 0)
+          return false;
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+      }
+
+      // Submits a write, the ring has room since every submission is entered right away
+      auto write(int fd,
+                 const char* data,
+                 std::size_t size,
+                 std::int64_t offset,
+                 int fixed_buffer,
+                 std::uint64_t user_data) -> int
+      {
+        const auto tail = *_sq_tail;
+        const auto index = tail & _sq_mask;
+        auto& sqe = _sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = fixed_buffer >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(data);
+        sqe.len = static_cast<std::uint32_t>(size);
+        sqe.off = static_cast<std::uint64_t>(offset);  // -1: the current position
+        if (fixed_buffer >= 0)
+          sqe.buf_index = static_cast<std::uint16_t>(fixed_buffer);
+        sqe.user_data = user_data;
+        _sq_array[index] = index;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        while (true)
+        {
+          const auto result = ::syscall(__NR_io_uring_enter, _fd, 1, 0, 0, nullptr, 0);
+          if (result >= 0)
+            return 0;
+          if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return errno;
+        }
+      }
+
+      // Blocks until at least one write has completed
+      auto wait() -> void
+      {
+        while (::syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+               errno == EINTR)
+        {
+        }
+      }
+
+      // Calls f(user_data, result) for each completed write, returns their number
+      template <typename F>
+      auto reap(F&& f) -> std::size_t
+      {
+        auto head = *_cq_head;
+        const auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        auto count = std::size_t{0};
+        for (; head != tail; ++head, ++count)
+        {
+          const auto& cqe = _cqes[head & _cq_mask];
+          const auto user_data = cqe.user_data;
+          const auto result = cqe.res;
+          __atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+          f(user_data, result);
+        }
+        return count;
+      }
+    };
+#endif
+  }
+
+  // Owns the buffers for uring_sinks and the io_uring instance that writes them. One thread can
+  // render into many sinks, while the filled buffers are written asynchronously. Without
+  // io_uring (e.g. older kernels or seccomp policies), buffers are written with write().
+  // Each open sink holds one buffer, so there have to be more buffers than open sinks.
+  class uring
+  {
+    std::size_t _buffer_size;
+    std::unique_ptr<char[]> _storage;
+    std::vector<uring_impl::buffer_t> _buffers;
+    std::vector<std::size_t> _free;
+    std::size_t _in_flight = 0;
+#if KISTE_IO_URING
+    uring_impl::ring _ring;
+#endif
+    bool _io_uring = false;
+    bool _fixed = false;  // the buffers are registered with the kernel
+
+    auto release(std::size_t index) -> void
+    {
+      auto& buffer = _buffers[index];
+      buffer._size = 0;
+      buffer._owner = nullptr;
+      _free.push_back(index);
+    }
+
+#if KISTE_IO_URING
+    auto submit(std::size_t index) -> void
+    {
+      auto& buffer = _buffers[index];
+      const auto offset = buffer._offset < 0 ? -1 : buffer._offset + static_cast<std::int64_t>(
+                                                                          buffer._written);
+      const auto error = _ring.write(buffer._owner->_fd, buffer._data + buffer._written,
+                                     buffer._size - buffer._written, offset,
+                                     _fixed ? static_cast<int>(index) : -1, index);
+      if (error)
+      {
+        buffer._owner->_error = error;
+        complete(index);
+      }
+    }
+
+    auto complete(std::size_t index) -> void
+    {
+      --_buffers[index]._owner->_in_flight;
+      --_in_flight;
+      release(index);
+    }
+
+    auto on_completion(std::uint64_t user_data, int result) -> void
+    {
+      const auto index = static_cast<std::size_t>(user_data);
+      auto& buffer = _buffers[index];
+      if (result == -EINTR || result == -EAGAIN)
+        return submit(index);
+      if (result == -EINVAL || result == -EOPNOTSUPP)
+      {
+        // The kernel or the file does not support the write, write() might
+        const auto offset = buffer._offset < 0 ? -1 : buffer._offset + static_cast<std::int64_t>(
+                                                                            buffer._written);
+        buffer._owner->_error =
+            uring_impl::write_all(buffer._owner->_fd, buffer._data + buffer._written,
+                                  buffer._size - buffer._written, offset);
+        return complete(index);
+      }
+      if (result < 0)
+      {
+        buffer._owner->_error = -result;
+        return complete(index);
+      }
+      if (result == 0)
+      {
+        buffer._owner->_error = EIO;
+        return complete(index);
+      }
+      buffer._written += static_cast<std::size_t>(result);
+      if (buffer._written < buffer._size)
+        return submit(index);  // short write
+      complete(index);
+    }
+#endif
+
+    // Processes completed writes, blocks until there is at least one if there are none
+    auto wait_one() -> void
+    {
+#if KISTE_IO_URING
+      const auto handler = [this](std::uint64_t user_data, int result)
+      { on_completion(user_data, result); };
+      if (_ring.reap(handler) == 0)
+      {
+        _ring.wait();
+        _ring.reap(handler);
+      }
+#endif
+    }
+
+  public:
+    explicit uring(std::size_t buffer_count = 64,
+                   std::size_t buffer_size = 1 << 16,
+                   bool use_io_uring = true)
+        : _buffer_size(buffer_size ? buffer_size : 1),
+          _storage(new char[(buffer_count ? buffer_count : 1) * _buffer_size])
+    {
+      buffer_count = buffer_count ? buffer_count : 1;
+      auto iovecs = std::vector<iovec>{};
+      for (std::size_t i = 0; i < buffer_count; ++i)
+      {
+        _buffers.emplace_back(_storage.get() + i * _buffer_size);
+        _free.push_back(buffer_count - 1 - i);
+        iovecs.push_back({_buffers.back()._data, _buffer_size});
+      }
+#if KISTE_IO_URING
+      if (use_io_uring)
+      {
+        auto entries = 1u;
+        while (entries < buffer_count)
+          entries *= 2;
+        _io_uring = _ring.open(entries);
+        _fixed = _io_uring && buffer_count <= 1024 &&
+                 _ring.register_buffers(iovecs.data(), static_cast<unsigned>(buffer_count));
+        _io_uring = _fixed || (_io_uring && _ring.supports(IORING_OP_WRITE));
+      }
+#else
+      static_cast<void>(use_io_uring);
+#endif
+    }
+
+    uring(const uring&) = delete;
+    uring& operator=(const uring&) = delete;
+
+    ~uring()
+    {
+      while (_in_flight)
+        wait_one();
+    }
+
+    auto uses_io_uring() const -> bool
+    {
+      return _io_uring;
+    }
+
+    auto uses_registered_buffers() const -> bool
+    {
+      return _fixed;
+    }
+
+    auto buffer_size() const -> std::size_t
+    {
+      return _buffer_size;
+    }
+
+    // Used by uring_sink, returns nullptr if all buffers are held by open sinks
+    auto acquire(uring_impl::sink_state& owner) -> uring_impl::buffer_t*
+    {
+      while (_free.empty())
+      {
+        if (_in_flight == 0)
+          return nullptr;
+        wait_one();
+      }
+      const auto index = _free.back();
+      _free.pop_back();
+      auto& buffer = _buffers[index];
+      buffer._owner = &owner;
+      return &buffer;
+    }
+
+    // Writes a buffer that was filled by its owner, the buffer is released afterwards
+    auto write(uring_impl::buffer_t& buffer) -> void
+    {
+      auto& owner = *buffer._owner;
+      const auto index = static_cast<std::size_t>(&buffer - _buffers.data());
+      buffer._written = 0;
+      buffer._offset = owner._offset;
+      if (owner._offset >= 0)
+        owner._offset += static_cast<std::int64_t>(buffer._size);
+      if (buffer._size == 0 || owner._error)
+        return release(index);
+      if (!_io_uring)
+      {
+        owner._error = uring_impl::write_all(owner._fd, buffer._data, buffer._size, buffer._offset);
+        return release(index);
+      }
+#if KISTE_IO_URING
+      // Pipes and sockets are written in order, one buffer at a time
+      if (buffer._offset < 0)
+        wait_for(owner);
+      ++owner._in_flight;
+      ++_in_flight;
+      submit(index);
+#endif
+    }
+
+    // Blocks until all writes of a sink have completed
+    auto wait_for(uring_impl::sink_state& owner) -> void
+    {
+      while (owner._in_flight)
+        wait_one();
+    }
+  };
+
+  namespace uring_impl
+  {
+    class sink_buffer : public std::streambuf
+    {
+      uring& _uring;
+      sink_state _state;
+      buffer_t* _buffer = nullptr;
+
+      auto submit() -> void
+      {
+        if (!_buffer)
+          return;
+        _buffer->_size = static_cast<std::size_t>(pptr() - pbase());
+        setp(nullptr, nullptr);
+        auto& buffer = *_buffer;
+        _buffer = nullptr;
+        _uring.write(buffer);
+      }
+
+      // Errors are recorded for close(), since the ostream would swallow exceptions
+      auto open() -> bool
+      {
+        submit();
+        if (_state._error)
+          return false;
+        _buffer = _uring.acquire(_state);
+        if (!_buffer)
+        {
+          _state._error = ENOBUFS;  // more open sinks than buffers
+          return false;
+        }
+        setp(_buffer->_data, _buffer->_data + _uring.buffer_size());
+        return true;
+      }
+
+    protected:
+      auto overflow(int_type c) -> int_type override
+      {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+          return traits_type::not_eof(c);
+        if (!open())
+          return traits_type::eof();
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+        return c;
+      }
+
+      auto xsputn(const char* s, std::streamsize n) -> std::streamsize override
+      {
+        auto remaining = static_cast<std::size_t>(n);
+        while (remaining)
+        {
+          if (pptr() == epptr() && !open())
+            return n - static_cast<std::streamsize>(remaining);
+          const auto count = std::min(remaining, static_cast<std::size_t>(epptr() - pptr()));
+          std::memcpy(pptr(), s, count);
+          pbump(static_cast<int>(count));
+          s += count;
+          remaining -= count;
+        }
+        return n;
+      }
+
+      // Submits the filled part of the buffer without waiting for the write
+      auto sync() -> int override
+      {
+        submit();
+        return 0;
+      }
+
+    public:
+      sink_buffer(uring& ring, int fd) : _uring(ring), _state(fd, ::lseek(fd, 0, SEEK_CUR))
+      {
+      }
+
+      auto close() -> void
+      {
+        submit();
+        _uring.wait_for(_state);
+        if (_state._offset >= 0)
+          ::lseek(_state._fd, static_cast<off_t>(_state._offset), SEEK_SET);
+        if (_state._error)
+        {
+          const auto error = _state._error;
+          _state._error = 0;
+          throw std::system_error(error, std::generic_category(), "kiste::uring_sink");
+        }
+      }
+    };
+  }
+
+  // Writes to a file, pipe or socket via the buffers of a kiste::uring. When a buffer is full
+  // (or the stream is flushed, e.g. by $flush), its write is submitted and rendering continues
+  // in the next buffer. Writes to files are submitted at their offsets, so several of them can
+  // be in flight. The file descriptor stays open.
+  class uring_sink
+  {
+    uring_impl::sink_buffer _buffer;
+    std::ostream _stream;
+
+  public:
+    uring_sink(uring& ring, int fd) : _buffer(ring, fd), _stream(&_buffer)
+    {
+    }
+
+    uring_sink(const uring_sink&) = delete;
+    uring_sink& operator=(const uring_sink&) = delete;
+
+    // Waits for outstanding writes, errors are ignored here. Call close() to see them.
+    ~uring_sink()
+    {
+      try
+      {
+        _buffer.close();
+      }
+      catch (...)
+      {
+      }
+    }
+
+    auto stream() -> std::ostream&
+    {
+      return _stream;
+    }
+
+    auto flush() -> void
+    {
+      _buffer.pubsync();
+    }
+
+    // Writes the rest and waits for all writes of this sink. Throws std::system_error if a write
+    // failed or if all buffers were held by other sinks (ENOBUFS).
+    auto close() -> void
+    {
+      _buffer.close();
+    }
+  };
+}
+
+#endif
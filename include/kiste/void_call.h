@@ -0,0 +1,53 @@
+#ifndef KISS_TEMPLATES_KISTE_VOID_CALL_H
+#define KISS_TEMPLATES_KISTE_VOID_CALL_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+namespace kiste
+{
+  // Generated code checks $call{} expressions via `static_cast<void>((expression), void_call_t{})`
+  // if kiste2cpp is called with --fast-compile. For void expressions, this is the built-in comma
+  // operator. Anything else selects the operator below, which is instantiated once per type
+  // instead of once per call.
+  struct void_call_t
+  {
+  };
+
+  template <typename T>
+  struct is_void_call_expression
+  {
+    static constexpr bool value = false;
+  };
+
+  template <typename T>
+  auto operator,(T&&, void_call_t) -> void
+  {
+    static_assert(is_void_call_expression<T>::value, "$call{} requires void expression");
+  }
+}
+
+#endif
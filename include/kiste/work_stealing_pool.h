@@ -0,0 +1,217 @@
+#ifndef KISS_TEMPLATES_KISTE_WORK_STEALING_POOL_H
+#define KISS_TEMPLATES_KISTE_WORK_STEALING_POOL_H
+
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// parallel_for and render_batch pass exceptions of tasks on to the calling thread, unless
+// compiled with -fno-exceptions
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define KISTE_EXCEPTIONS 1
+#else
+#define KISTE_EXCEPTIONS 0
+#endif
+
+namespace kiste
+{
+  // A fixed set of worker threads with one task queue each. Workers run the newest task of their
+  // own queue first and steal the oldest tasks of other queues when idle. Threads waiting for
+  // tasks to finish should help with run_pending_task().
+  class work_stealing_pool
+  {
+  public:
+    using task_t = std::function<void()>;
+
+  private:
+    struct queue
+    {
+      std::mutex _mutex;
+      std::deque<task_t> _tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::atomic<std::size_t> _pending;
+    std::atomic<std::size_t> _next_queue;
+    bool _stopping;
+
+    // The queue of the calling thread, if it is a worker of this pool
+    static auto current_worker() -> std::pair<const work_stealing_pool*, std::size_t>&
+    {
+      static thread_local auto worker = std::pair<const work_stealing_pool*, std::size_t>{};
+      return worker;
+    }
+
+    auto own_queue() const -> std::size_t
+    {
+      const auto& worker = current_worker();
+      return worker.first == this ? worker.second : _queues.size();
+    }
+
+    auto try_pop(std::size_t index, task_t& task) -> bool
+    {
+      if (index < _queues.size())
+      {
+        auto& q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q._mutex);
+        if (!q._tasks.empty())
+        {
+          task = std::move(q._tasks.back());
+          q._tasks.pop_back();
+          --_pending;
+          return true;
+        }
+      }
+      for (std::size_t i = 1; i <= _queues.size(); ++i)
+      {
+        auto& q = *_queues[(index + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(q._mutex);
+        if (!q._tasks.empty())
+        {
+          task = std::move(q._tasks.front());
+          q._tasks.pop_front();
+          --_pending;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    auto work(std::size_t index) -> void
+    {
+      current_worker() = {this, index};
+      auto task = task_t{};
+      while (true)
+      {
+        if (try_pop(index, task))
+        {
+          task();
+          task = nullptr;
+          continue;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this] { return _stopping || _pending > 0; });
+        if (_stopping && _pending == 0)
+          return;
+      }
+    }
+
+  public:
+    explicit work_stealing_pool(std::size_t thread_count)
+        : _pending(0), _next_queue(0), _stopping(false)
+    {
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        _queues.emplace_back(new queue);
+      }
+      for (std::size_t i = 0; i < thread_count; ++i)
+      {
+        _threads.emplace_back([this, i] { work(i); });
+      }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    // Runs the remaining tasks before joining the threads
+    ~work_stealing_pool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+      }
+      _wake.notify_all();
+      for (auto& thread : _threads)
+      {
+        thread.join();
+      }
+    }
+
+    auto size() const -> std::size_t
+    {
+      return _threads.size();
+    }
+
+    // Workers push to their own queue, other threads distribute their tasks over all queues.
+    // Without threads, the task is run right away.
+    auto submit(task_t task) -> void
+    {
+      if (_queues.empty())
+      {
+        task();
+        return;
+      }
+      auto index = own_queue();
+      if (index == _queues.size())
+      {
+        index = _next_queue++ % _queues.size();
+      }
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_pending;
+      }
+      {
+        auto& q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q._mutex);
+        q._tasks.push_back(std::move(task));
+      }
+      _wake.notify_one();
+    }
+
+    // Runs one queued task in the calling thread. Returns false if there was none.
+    auto run_pending_task() -> bool
+    {
+      auto task = task_t{};
+      if (_queues.empty() || !try_pop(own_queue(), task))
+        return false;
+      task();
+      return true;
+    }
+
+    // Shared by all templates, the threads calling parallel_for make up for the last core
+    static auto instance() -> work_stealing_pool&
+    {
+      static work_stealing_pool pool{
+          std::max(std::thread::hardware_concurrency(), 1u) - 1};
+      return pool;
+    }
+  };
+}
+
+#endif
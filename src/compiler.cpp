@@ -0,0 +1,766 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "segment_type.h"
+#include <KisteTemplate.h>
+#include <ClassTemplate.h>
+#include <LineTemplate.h>
+#include "parse_context.h"
+#include "line.h"
+#include <kiste/cpp.h>
+#include <kiste/compiler.h>
+
+namespace kiste
+{
+  namespace
+  {
+    bool starts_with(const std::string& text, const std::string& start)
+    {
+      if (start.size() > text.size())
+        return false;
+      for (std::size_t i = 0; i < start.size(); ++i)
+      {
+        if (start[i] != text[i])
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    auto parse_expression(const std::string& line, segment_type type, std::size_t pos) -> segment_t
+    {
+      auto expression = std::string{};
+      auto arg_curly_level = 1;
+
+      for (; pos < line.size() and arg_curly_level; ++pos)
+      {
+        switch (line.at(pos))
+        {
+        case '{':
+          ++arg_curly_level;
+          expression.push_back(line.at(pos));
+          break;
+        case '}':
+          --arg_curly_level;
+          if (arg_curly_level)
+          {
+            expression.push_back(line.at(pos));
+          }
+          else
+          {
+            // do nothing, as this probably the closing curly brace of the command
+          }
+          break;
+        default:
+          expression.push_back(line.at(pos));
+        }
+      }
+      if (arg_curly_level > 0)
+      {
+        throw parse_error("missing closing brace");
+      }
+      --pos;
+
+      return {pos, type, expression};
+    }
+
+    auto is_identifier_char(char c) -> bool
+    {
+      return std::isalnum(static_cast<unsigned char>(c)) or c == '_';
+    }
+
+    auto is_identifier(const std::string& text) -> bool
+    {
+      if (text.empty() or std::isdigit(static_cast<unsigned char>(text[0])))
+        return false;
+      for (const auto c : text)
+      {
+        if (not is_identifier_char(c))
+          return false;
+      }
+      return true;
+    }
+
+    auto parse_command(const std::string& line, std::size_t pos) -> segment_t
+    {
+      // std::clog << "----------------------------------" << std::endl;
+      // std::clog << "line: " << line.substr(pos) << std::endl;
+      if (pos == line.size())
+      {
+        throw parse_error("Missing command after '$'");
+      }
+      else if (line.at(pos) == '$')
+      {
+        return {pos, segment_type::text, "$"};
+      }
+      else if (line.at(pos) == '%')
+      {
+        return {pos, segment_type::text, "%"};
+      }
+      else if (line.at(pos) == '|')
+      {
+        if (pos != line.size() - 1)
+        {
+          throw parse_error("Trailing characters after trim-right ($|)");
+        }
+        return {pos, segment_type::trim_trailing_return, ""};
+      }
+      else if (line.at(pos) == '{')
+      {
+        return parse_expression(line, segment_type::escape, pos + 1);
+      }
+      else if (line.substr(pos, 4) == "raw{")
+      {
+        return parse_expression(line, segment_type::raw, pos + 4);
+      }
+      else if (line.substr(pos, 5) == "call{")
+      {
+        return parse_expression(line, segment_type::call, pos + 5);
+      }
+      else if (line.substr(pos, 5) == "slot{")
+      {
+        return parse_expression(line, segment_type::slot, pos + 5);
+      }
+      else if (line.substr(pos, 5) == "flush" and
+               (pos + 5 == line.size() or not is_identifier_char(line[pos + 5])))
+      {
+        return {pos + 4, segment_type::flush, ""};
+      }
+      else
+      {
+        throw parse_error("Unknown command: " + line.substr(pos));
+      }
+    }
+
+    auto parse_text_line(const parse_context& ctx, const std::string& line) -> line_data_t
+    {
+      if (ctx._curly_level <= ctx._class_curly_level)
+        throw parse_error("Unexpected text outside of member function");
+
+      auto text_line = line_data_t{line_type::text, {}};
+      for (std::size_t pos = 0; pos < line.size(); ++pos)
+      {
+        switch (line.at(pos))
+        {
+        case '$':
+        {
+          pos = text_line.add_segment(parse_command(line, ++pos));
+          break;
+        }
+        default:
+          text_line.add_character(line.at(pos));
+          break;
+        }
+      }
+
+      return text_line;
+    }
+
+    auto parse_parent_class(const std::string& line) -> std::string
+    {
+      const auto colonPos = line.find_first_not_of(" \t");
+      if (colonPos == line.npos)
+      {
+        return "";
+      }
+      if (line[colonPos] != ':')
+      {
+        throw parse_error("Unexpected character after class name, did you forget a ':'?");
+      }
+      const auto nameBegin = line.find_first_not_of(" \t", colonPos + 1);
+      if (nameBegin == line.npos)
+      {
+        throw parse_error("Could not find parent class name");
+      }
+      const auto nameEnd = line.find_first_of(" \t", nameBegin);
+      const auto parent_name = (nameEnd == line.npos) ? line.substr(nameBegin)
+                                                      : line.substr(nameBegin, nameEnd - nameBegin);
+
+      if (nameEnd != line.npos and line.find_first_not_of(" \t", nameEnd) != line.npos)
+      {
+        throw parse_error("Unexpected trailing characters after parent class name");
+      }
+
+      return parent_name;
+    }
+
+    auto parse_class_member(const parse_context& ctx, const std::string& line) -> member_t
+    {
+      if (not ctx._class_curly_level)
+      {
+        throw parse_error("Cannot add a member here, did you forget to call $class?");
+      }
+      const auto classBegin = line.find_first_not_of(" \t", std::strlen("member"));
+      if (classBegin == line.npos)
+        throw parse_error("Could not find member class name");
+      const auto classEnd = line.find_first_of(" \t", classBegin);
+      if (classEnd == line.npos)
+        throw parse_error("Could not find member name");
+
+      const auto member_class_name = line.substr(classBegin, classEnd - classBegin);
+
+      const auto nameBegin = line.find_first_not_of(" \t", classEnd);
+      if (nameBegin == line.npos)
+        throw parse_error("Could not find member name");
+      const auto nameEnd = line.find_first_of(" \t", nameBegin);
+
+      const auto member_name = (nameEnd == line.npos) ? line.substr(nameBegin)
+                                                      : line.substr(nameBegin, nameEnd - nameBegin);
+
+      if (line.find_first_not_of(" \t", nameEnd) != line.npos)
+      {
+        throw parse_error("unexpected characters after member declaration");
+      }
+
+      return {member_class_name, member_name};
+    }
+
+    auto parse_class(const parse_context& ctx, const std::string& line) -> class_t
+    {
+      if (ctx._class_curly_level)
+        throw parse_error("Cannot open new class here, did you forget to call $endclass?");
+      const auto nameBegin = line.find_first_not_of(" \t", std::strlen("class"));
+      if (nameBegin == line.npos)
+        throw parse_error("Could not find class name");
+      const auto nameEnd = line.find_first_of(" \t", nameBegin);
+
+      auto cd = class_t{};
+      cd._namespace = ctx.current_namespace();
+      cd._at_namespace_scope = ctx.is_at_namespace_scope();
+      cd._name = (nameEnd == line.npos) ? line.substr(nameBegin)
+                                        : line.substr(nameBegin, nameEnd - nameBegin);
+      if (nameEnd != line.npos)
+      {
+        cd._parent_name = parse_parent_class(line.substr(nameEnd));
+      };
+
+      return cd;
+    }
+
+    auto trim(const std::string& text) -> std::string
+    {
+      const auto begin = text.find_first_not_of(" \t");
+      if (begin == text.npos)
+        return "";
+      return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+    }
+
+    // `$parallel_for (declaration : range)`, like a range based for loop
+    auto parse_parallel_for(const std::string& line) -> parallel_for_t
+    {
+      const auto open = line.find_first_not_of(" \t", std::strlen("parallel_for"));
+      if (open == line.npos or line[open] != '(')
+        throw parse_error("Expected '(' after $parallel_for");
+      const auto close = line.find_last_not_of(" \t");
+      if (line[close] != ')')
+        throw parse_error("Expected ')' at the end of $parallel_for");
+
+      auto level = 0;
+      for (auto pos = open + 1; pos < close; ++pos)
+      {
+        switch (line[pos])
+        {
+        case '(':
+        case '[':
+        case '{':
+          ++level;
+          break;
+        case ')':
+        case ']':
+        case '}':
+          --level;
+          break;
+        case ':':
+          if (line[pos + 1] == ':')
+          {
+            ++pos;
+          }
+          else if (level == 0)
+          {
+            auto result = parallel_for_t{};
+            result._declaration = trim(line.substr(open + 1, pos - open - 1));
+            result._range = trim(line.substr(pos + 1, close - pos - 1));
+            if (result._declaration.empty() or result._range.empty())
+              throw parse_error("Expected $parallel_for (declaration : range)");
+            return result;
+          }
+          break;
+        default:
+          break;
+        }
+      }
+      throw parse_error("Expected $parallel_for (declaration : range)");
+    }
+
+    auto parse_line(const parse_context& ctx) -> line_data_t
+    {
+      const auto pos_first_char = ctx._line.find_first_not_of(" \t");
+      if (pos_first_char == ctx._line.npos)
+      {
+        if (ctx._class_curly_level and ctx._curly_level > ctx._class_curly_level)
+        {
+          return parse_text_line(ctx, ctx._line);
+        }
+        else
+        {
+          return line_data_t{};
+        }
+      }
+      else
+      {
+        const auto rest = ctx._line.substr(pos_first_char + 1);
+        switch (ctx._line.at(pos_first_char))
+        {
+        case '%':  // cpp line
+          return line_data_t{line_type::cpp,
+                             std::vector<segment_t>{{0,
+                                                     segment_type::cpp,
+                                                     ctx._line.substr(0, pos_first_char) +
+                                                         ctx._line.substr(pos_first_char + 1)}}};
+          break;
+        case '$':  // opening / closing class or text line
+          if (starts_with(rest, "class"))
+          {
+            return {parse_class(ctx, rest)};
+          }
+          else if (starts_with(rest, "endclass"))
+          {
+            return {line_type::class_end, {}};
+          }
+          else if (starts_with(rest, "member"))
+          {
+            return parse_class_member(ctx, rest);
+          }
+          else if (starts_with(rest, "parallel_for"))
+          {
+            return {parse_parallel_for(rest)};
+          }
+          else if (starts_with(rest, "endfor"))
+          {
+            return {line_type::parallel_for_end, {}};
+          }
+          else if (starts_with(rest, "|"))  // trim left
+          {
+            return parse_text_line(ctx, ctx._line.substr(pos_first_char + 2));
+          }
+          else
+          {
+            return parse_text_line(ctx, ctx._line);
+          }
+          break;
+        default:
+          return parse_text_line(ctx, ctx._line);
+        }
+      }
+    }
+
+    // Returns the file name of an #include directive, or an empty string
+    auto parse_include(const std::string& cpp) -> std::string
+    {
+      auto pos = cpp.find_first_not_of(" \t");
+      if (pos == cpp.npos or cpp[pos] != '#')
+        return "";
+      pos = cpp.find_first_not_of(" \t", pos + 1);
+      if (pos == cpp.npos or cpp.compare(pos, 7, "include") != 0)
+        return "";
+      pos = cpp.find_first_not_of(" \t", pos + 7);
+      if (pos == cpp.npos or (cpp[pos] != '<' and cpp[pos] != '"'))
+        return "";
+      const auto end = cpp.find(cpp[pos] == '<' ? '>' : '"', pos + 1);
+      if (end == cpp.npos)
+        return "";
+      return cpp.substr(pos + 1, end - pos - 1);
+    }
+
+    auto qualified_name(const class_info& c) -> std::string
+    {
+      return c._namespace.empty() ? c._name : c._namespace + "::" + c._name;
+    }
+
+    // Two lists of classes, e.g. those of this template and those of other templates. They are
+    // searched in order and in place, since lookups happen for every fused call.
+    struct class_lists
+    {
+      const std::vector<class_info>& _first;
+      const std::vector<class_info>& _second;
+    };
+
+    // Finds a class by the name used for it in the given namespace, searching from the innermost
+    // namespace outwards like C++ name lookup does
+    auto find_class(const class_lists& classes, std::string scope, std::string name)
+        -> const class_info*
+    {
+      if (starts_with(name, "::"))
+      {
+        scope.clear();
+        name = name.substr(2);
+      }
+      while (true)
+      {
+        const auto candidate = scope.empty() ? name : scope + "::" + name;
+        for (const auto list : {&classes._first, &classes._second})
+        {
+          for (const auto& c : *list)
+          {
+            if (qualified_name(c) == candidate)
+              return &c;
+          }
+        }
+        if (scope.empty())
+          return nullptr;
+        const auto pos = scope.rfind("::");
+        scope = (pos == scope.npos) ? std::string{} : scope.substr(0, pos);
+      }
+    }
+
+    // Finds the member function called by `name` in class c or its parents
+    auto find_function(const class_lists& classes, const class_info* c,
+                       const std::string& name) -> const function_info*
+    {
+      for (auto depth = 0; c and depth < 64; ++depth)
+      {
+        const function_info* found = nullptr;
+        auto count = 0;
+        for (const auto& function : c->_functions)
+        {
+          if (function._name == name)
+          {
+            found = &function;
+            ++count;
+          }
+        }
+        if (count)
+        {
+          return count == 1 ? found : nullptr;  // overloads are not fused
+        }
+        c = c->_parent_name.empty() ? nullptr : find_class(classes, c->_namespace, c->_parent_name);
+      }
+      return nullptr;
+    }
+
+    // Finds the class of a member template of class c or its parents
+    auto find_member_class(const class_lists& classes, const class_info* c,
+                           const std::string& member) -> const class_info*
+    {
+      for (auto depth = 0; c and depth < 64; ++depth)
+      {
+        for (std::size_t i = 0; i < c->_member_names.size(); ++i)
+        {
+          if (c->_member_names[i] == member)
+          {
+            return find_class(classes, c->_namespace, c->_member_class_names[i]);
+          }
+        }
+        c = c->_parent_name.empty() ? nullptr : find_class(classes, c->_namespace, c->_parent_name);
+      }
+      return nullptr;
+    }
+
+    // Returns the text of the function called by a $call{} expression like "footer()",
+    // "parent.header()" or "helper.render()", if that function emits nothing but text. Calls via
+    // `child` are not resolved, since the child differs for each class derived from this one.
+    auto static_call_text(const parse_context& ctx,
+                          const std::string& expression,
+                          std::string& text) -> bool
+    {
+      auto call = std::string{};
+      for (const auto c : expression)
+      {
+        if (c != ' ' and c != '\t')
+          call.push_back(c);
+      }
+      if (call.size() < 3 or call.compare(call.size() - 2, 2, "()") != 0)
+        return false;
+      call.resize(call.size() - 2);
+      if (starts_with(call, "this->"))
+        call = call.substr(6);
+
+      const auto classes = class_lists{ctx._known_classes, ctx._classes};
+      const auto& current = ctx._classes.back();
+      const class_info* c = find_class(classes, current._namespace, current._name);
+
+      const auto dot = call.find('.');
+      if (dot != call.npos)
+      {
+        const auto object = call.substr(0, dot);
+        call = call.substr(dot + 1);
+        if (object == "parent")
+        {
+          c = c->_parent_name.empty() ? nullptr
+                                      : find_class(classes, c->_namespace, c->_parent_name);
+        }
+        else if (is_identifier(object) and object != "child")
+        {
+          c = find_member_class(classes, c, object);
+        }
+        else
+        {
+          return false;
+        }
+      }
+      if (not is_identifier(call))
+        return false;
+
+      const auto function = find_function(classes, c, call);
+      if (not function or not function->_static_text)
+        return false;
+      text = function->_text;
+      return true;
+    }
+
+    auto fuse_static_calls(const parse_context& ctx, line_data_t& line_data) -> void
+    {
+      if (line_data._type != line_type::text or not ctx._in_class_info)
+        return;
+
+      auto fused = line_data_t{line_type::text, {}};
+      auto changed = false;
+      for (const auto& segment : line_data._segments)
+      {
+        auto text = std::string{};
+        if (segment._type == segment_type::call and static_call_text(ctx, segment._text, text))
+        {
+          fused.add_segment({segment._end_pos, segment_type::text, text});
+          changed = true;
+        }
+        else
+        {
+          fused.add_segment(segment);
+        }
+      }
+      if (changed)
+      {
+        line_data = std::move(fused);
+      }
+    }
+
+
+    // Parses the input line by line and hands each line to the callback as soon as the next
+    // line is known. Text can only be joined with its direct neighbours, so a single line of
+    // lookahead is all the state that is required, no matter how large the input is.
+    template <typename Callback>
+    auto parse(parse_context& ctx, const Callback& callback) -> void
+    {
+      auto previous_line = line_t{};
+      auto has_previous_line = false;
+
+      while (ctx._is.good())
+      {
+        ++ctx._line_no;
+        getline(ctx._is, ctx._line);
+
+        auto line_data = parse_line(ctx);
+        if (ctx._fuse_static_calls)
+        {
+          fuse_static_calls(ctx, line_data);
+        }
+        ctx.update(line_data);
+        auto line = line_t{ctx, line_data};
+
+        if (has_previous_line)
+        {
+          // As before streaming, the first two lines are not linked. Neither are lines of
+          // pull_task functions, so that each of them ends with a suspension point.
+          if (ctx._line_no > 2 and not line._function_pulls and not previous_line._function_pulls)
+          {
+            line._previous_line_ends_with_text = previous_line.ends_with_text();
+            previous_line._next_line_starts_with_text = line.starts_with_text();
+          }
+          callback(previous_line);
+        }
+        previous_line = std::move(line);
+        has_previous_line = true;
+      }
+      if (has_previous_line)
+      {
+        if (previous_line._curly_level)
+        {
+          throw parse_error("not enough closing curly braces");
+        }
+        callback(previous_line);
+      }
+    }
+
+    // Collects the specializations of a class and, recursively, of its parent and members.
+    // Classes that are not known (e.g. because their template was not found) are skipped, they
+    // get instantiated implicitly as usual.
+    auto collect_instantiations(const class_lists& classes,
+                                const class_info& c,
+                                const std::string& derived,
+                                const instantiation& inst,
+                                std::vector<const class_info*>& path,
+                                std::vector<std::string>& types) -> void
+    {
+      if (std::find(path.begin(), path.end(), &c) != path.end())
+        return;
+
+      const auto type = "::" + qualified_name(c) + "_t<" + derived + ", " + inst._data_type + ", " +
+                        inst._serializer_type + ">";
+      if (std::find(types.begin(), types.end(), type) == types.end())
+      {
+        types.push_back(type);
+      }
+
+      auto related_class_names = c._member_class_names;
+      if (not c._parent_name.empty())
+      {
+        related_class_names.insert(related_class_names.begin(), c._parent_name);
+      }
+      path.push_back(&c);
+      for (const auto& name : related_class_names)
+      {
+        if (const auto related = find_class(classes, c._namespace, name))
+        {
+          collect_instantiations(classes, *related, type, inst, path, types);
+        }
+      }
+      path.pop_back();
+    }
+
+    auto generate(parse_context& ctx, const compiler_options& options, compile_result& result)
+        -> void
+    {
+      auto serializer = ::kiste::cpp(ctx._os);
+      auto kissTemplate = ::kiste::KisteTemplate(ctx, serializer);
+      auto classTemplate = ::kiste::ClassTemplate(ctx, serializer);
+      auto lineTemplate = ::kiste::LineTemplate(ctx, serializer);
+
+      auto class_data = class_t{};
+
+      kissTemplate.render_header();
+      parse(ctx, [&](const line_t& line)
+            {
+              switch (line._type)
+              {
+              case line_type::none:
+                lineTemplate.render_none();
+                break;
+              case line_type::cpp:
+              {
+                const auto include = parse_include(line._segments[0]._text);
+                if (not include.empty())
+                {
+                  ctx._includes.push_back(include);
+                }
+                lineTemplate.render_cpp(line);
+                break;
+              }
+              case line_type::text:
+                lineTemplate.render_text(line);
+                break;
+              case line_type::class_begin:
+                class_data = line._class_data;
+                classTemplate.render_header(line._line_no, class_data);
+                break;
+              case line_type::member:
+                classTemplate.render_member(line._line_no, class_data, line._member);
+                break;
+              case line_type::class_end:
+                classTemplate.render_footer(line._line_no, class_data);
+                break;
+              case line_type::parallel_for_begin:
+                lineTemplate.render_parallel_for_begin(line);
+                break;
+              case line_type::parallel_for_end:
+                lineTemplate.render_parallel_for_end(line);
+                break;
+              }
+            });
+      kissTemplate.render_footer();
+      result._classes = ctx._classes;
+
+      if (not options._instantiations.empty())
+      {
+        const auto classes = class_lists{result._classes, options._known_classes};
+        auto types = std::vector<std::string>{};
+        for (const auto& inst : options._instantiations)
+        {
+          for (std::size_t i = 0; i < result._classes.size(); ++i)
+          {
+            auto path = std::vector<const class_info*>{};
+            collect_instantiations(
+                classes, result._classes[i], "::kiste::terminal_t", inst, path, types);
+          }
+        }
+        kissTemplate.render_instantiation_declarations(options._instantiation_includes, types);
+
+        std::ostringstream definitions;
+        auto definition_serializer = ::kiste::cpp(definitions);
+        ::kiste::KisteTemplate(ctx, definition_serializer).render_instantiation_definitions(types);
+        result._instantiation_definitions = definitions.str();
+      }
+    }
+  }
+
+  auto compile(std::istream& is,
+               std::ostream& os,
+               const std::string& filename,
+               const compiler_options& options) -> compile_result
+  {
+    auto result = compile_result{};
+    auto ctx = parse_context{is, os, filename, options};
+    try
+    {
+      generate(ctx, options, result);
+      result._success = true;
+    }
+    catch (const parse_error& e)
+    {
+      auto d = diagnostic{};
+      d._filename = ctx._filename;
+      d._line_no = ctx._line_no;
+      d._message = e.what();
+      d._line = ctx._line;
+      result._diagnostics.push_back(std::move(d));
+    }
+    result._includes = std::move(ctx._includes);
+    return result;
+  }
+
+  auto compile(const std::string& source,
+               const std::string& filename,
+               const compiler_options& options) -> compile_result
+  {
+    std::istringstream is{source};
+    std::ostringstream os;
+    auto result = compile(is, os, filename, options);
+    if (result._success)
+    {
+      result._code = os.str();
+    }
+    return result;
+  }
+}
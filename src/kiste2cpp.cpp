@@ -25,339 +25,549 @@
  */
 
 #include <ciso646>  // Make MSCV understand and/or/not
-#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <string>
-#include "segment_type.h"
-#include <KisteTemplate.h>
-#include <ClassTemplate.h>
-#include <LineTemplate.h>
-#include "parse_context.h"
-#include "line.h"
-#include <kiste/cpp.h>
-
-namespace kiste
+#include "output_file.h"
+#include "watch.h"
+#include <kiste/compiler.h>
+
+namespace
 {
-  bool starts_with(const std::string& text, const std::string& start)
+  auto directory_of(const std::string& path) -> std::string
   {
-    if (start.size() > text.size())
-      return false;
-    for (std::size_t i = 0; i < start.size(); ++i)
+    const auto name_begin = path.find_last_of("/\\");
+    return (name_begin == path.npos) ? std::string{"."} : path.substr(0, name_begin);
+  }
+
+  // Mirrors CMake's NAME_WE, so that add_kiss_templates knows the names of the generated headers
+  auto output_file_name(const std::string& source_file_path) -> std::string
+  {
+    const auto name_begin = source_file_path.find_last_of("/\\");
+    const auto name = (name_begin == source_file_path.npos) ? source_file_path
+                                                            : source_file_path.substr(name_begin + 1);
+    return name.substr(0, name.find('.')) + ".h";
+  }
+
+  // The file with the explicit instantiations that belongs to a generated header
+  auto instantiation_file_path(const std::string& output_file_path) -> std::string
+  {
+    const auto extension = std::string{".h"};
+    const auto has_extension =
+        output_file_path.size() > extension.size() and
+        output_file_path.compare(output_file_path.size() - extension.size(), extension.size(),
+                                 extension) == 0;
+    return (has_extension ? output_file_path.substr(0, output_file_path.size() - extension.size())
+                          : output_file_path) +
+           ".cpp";
+  }
+
+  auto file_exists(const std::string& path) -> bool
+  {
+    return std::ifstream{path}.good();
+  }
+
+  // Headers generated from other templates (e.g. for parent classes or members) are recognized by
+  // a template next to the source with the same name as the included header. Returns the path of
+  // that template or an empty string.
+  auto template_of_include(const std::string& source_file_path, const std::string& include)
+      -> std::string
+  {
+    const auto template_path =
+        directory_of(source_file_path) + "/" + include.substr(0, include.rfind('.')) + ".kiste";
+    return file_exists(template_path) ? template_path : std::string{};
+  }
+
+  // The generated header depends on its template and on the headers generated from other templates
+  // that it includes.
+  auto collect_dependencies(const std::string& source_file_path,
+                            const kiste::compile_result& result,
+                            const std::string& output_file_path,
+                            std::vector<std::string>& dependencies) -> void
+  {
+    dependencies.push_back(source_file_path);
+    const auto output_dir = directory_of(output_file_path);
+    for (const auto& include : result._includes)
     {
-      if (start[i] != text[i])
+      if (not template_of_include(source_file_path, include).empty())
       {
-        return false;
+        dependencies.push_back(output_dir + "/" + include);
       }
     }
+  }
+
+  auto read_file(const std::string& path, std::string& content) -> bool
+  {
+    std::ifstream ifs{path};
+    if (not ifs)
+      return false;
+    std::ostringstream os;
+    os << ifs.rdbuf();
+    content = os.str();
     return true;
   }
 
-  auto parse_expression(const std::string& line, segment_type type, std::size_t pos) -> segment_t
+  auto count_static_functions(const std::vector<kiste::class_info>& classes) -> std::size_t
+  {
+    auto count = std::size_t{0};
+    for (const auto& c : classes)
+    {
+      for (const auto& function : c._functions)
+      {
+        count += function._static_text ? 1 : 0;
+      }
+    }
+    return count;
+  }
+
+  // Collects the classes of all templates that the given template includes directly or
+  // indirectly, so that explicit instantiations can cover parents and members. Their templates
+  // are added to the dependencies.
+  // For --fuse-static-calls, the classes of the template itself are collected, too. Fusing calls
+  // can turn more functions into static ones, so the templates are scanned until that stops.
+  auto collect_known_classes(const std::string& source_file_path,
+                             const std::string& source,
+                             const kiste::compiler_options& opts,
+                             std::vector<kiste::class_info>& classes,
+                             std::vector<std::string>& dependencies) -> void
   {
-    auto expression = std::string{};
-    auto arg_curly_level = 1;
+    auto scan_opts = opts;
+    scan_opts._instantiations.clear();
+    scan_opts._fuse_static_calls = false;
+    auto sources = std::vector<std::pair<std::string, std::string>>{{source_file_path, source}};
+    auto found = std::vector<kiste::class_info>{};
+    auto own = kiste::compile(source, source_file_path, scan_opts);
+    auto pending = own._includes;
+    auto scanned = std::vector<std::string>{source_file_path};
+    while (not pending.empty())
+    {
+      const auto include = pending.back();
+      pending.pop_back();
+      const auto template_path = template_of_include(source_file_path, include);
+      if (template_path.empty() or
+          std::find(scanned.begin(), scanned.end(), template_path) != scanned.end())
+        continue;
+      scanned.push_back(template_path);
+      dependencies.push_back(template_path);
+
+      auto included_source = std::string{};
+      if (not read_file(template_path, included_source))
+        continue;
+      const auto result = kiste::compile(included_source, template_path, scan_opts);
+      found.insert(found.end(), result._classes.begin(), result._classes.end());
+      pending.insert(pending.end(), result._includes.begin(), result._includes.end());
+      sources.emplace_back(template_path, included_source);
+    }
 
-    for (; pos < line.size() and arg_curly_level; ++pos)
+    if (opts._fuse_static_calls)
     {
-      switch (line.at(pos))
+      found.insert(found.begin(), own._classes.begin(), own._classes.end());
+      scan_opts._fuse_static_calls = true;
+      for (auto count = std::size_t{0}; count != count_static_functions(found);)
       {
-      case '{':
-        ++arg_curly_level;
-        expression.push_back(line.at(pos));
-        break;
-      case '}':
-        --arg_curly_level;
-        if (arg_curly_level)
+        count = count_static_functions(found);
+        scan_opts._known_classes = found;
+        found.clear();
+        for (const auto& s : sources)
         {
-          expression.push_back(line.at(pos));
+          const auto result = kiste::compile(s.second, s.first, scan_opts);
+          found.insert(found.end(), result._classes.begin(), result._classes.end());
         }
-        else
+      }
+    }
+    classes.insert(classes.end(), found.begin(), found.end());
+  }
+
+  auto trim(const std::string& text) -> std::string
+  {
+    const auto begin = text.find_first_not_of(" \t\r");
+    if (begin == text.npos)
+      return "";
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+  }
+
+  // Parses "DATA_TYPE, SERIALIZER_TYPE". Commas within template arguments are ignored.
+  auto parse_instantiation(const std::string& text, kiste::instantiation& inst) -> bool
+  {
+    auto level = 0;
+    for (std::size_t pos = 0; pos < text.size(); ++pos)
+    {
+      switch (text[pos])
+      {
+      case '<':
+      case '(':
+        ++level;
+        break;
+      case '>':
+      case ')':
+        --level;
+        break;
+      case ',':
+        if (level == 0)
         {
-          // do nothing, as this probably the closing curly brace of the command
+          inst._data_type = trim(text.substr(0, pos));
+          inst._serializer_type = trim(text.substr(pos + 1));
+          return not inst._data_type.empty() and not inst._serializer_type.empty() and
+                 inst._serializer_type.find(',') == std::string::npos;
         }
         break;
-      default:
-        expression.push_back(line.at(pos));
       }
     }
-    if (arg_curly_level > 0)
+    return false;
+  }
+
+  // Reads a file with explicit instantiations: "#include" lines, which are required to declare
+  // the types, and lines of the form "DATA_TYPE, SERIALIZER_TYPE". Empty lines and lines
+  // starting with "//" are ignored.
+  auto read_instantiations(const std::string& path, kiste::compiler_options& opts) -> bool
+  {
+    std::ifstream ifs{path};
+    if (not ifs)
+    {
+      std::cerr << "Could not open " << path << std::endl;
+      return false;
+    }
+    auto line_no = 0;
+    for (auto line = std::string{}; getline(ifs, line);)
     {
-      throw parse_error("missing closing brace");
+      ++line_no;
+      line = trim(line);
+      if (line.empty() or line.compare(0, 2, "//") == 0)
+        continue;
+      if (line[0] == '#')
+      {
+        opts._instantiation_includes.push_back(line);
+        continue;
+      }
+      auto inst = kiste::instantiation{};
+      if (not parse_instantiation(line, inst))
+      {
+        std::cerr << path << ":" << line_no << ": expected DATA_TYPE, SERIALIZER_TYPE" << std::endl;
+        return false;
+      }
+      opts._instantiations.push_back(inst);
     }
-    --pos;
+    return true;
+  }
 
-    return {pos, type, expression};
+  auto write_instantiation_file(const std::string& path,
+                                const std::string& output_file_path,
+                                const std::string& definitions) -> bool
+  {
+    const auto temporary_file_path = kiste::temporary_path(path);
+    std::ofstream ofs{temporary_file_path};
+    ofs << "// generated by kiste2cpp\n"
+        << "#include \"" << output_file_path.substr(output_file_path.find_last_of("/\\") + 1)
+        << "\"\n\n" << definitions;
+    ofs.close();
+    if (not ofs)
+      return false;
+    return kiste::replace_if_changed(temporary_file_path, path) != kiste::replace_result::failed;
   }
 
-  auto parse_command(const std::string& line, std::size_t pos) -> segment_t
+  auto report_diagnostic(std::ostream& errors, const kiste::diagnostic& d) -> void
   {
-    // std::clog << "----------------------------------" << std::endl;
-    // std::clog << "line: " << line.substr(pos) << std::endl;
-    if (pos == line.size())
-    {
-      throw parse_error("Missing command after '$'");
-    }
-    else if (line.at(pos) == '$')
+    errors << "Parse error in file: " << d._filename << std::endl;
+    errors << "Line number: " << d._line_no << std::endl;
+    errors << "Message: " << d._message << std::endl;
+    errors << "Line: " << d._line << std::endl;
+  }
+
+  // Generates the header for one template. An empty output_file_path means stdout.
+  // Files are written via a temporary file and only replaced if their content changes.
+  // Errors are written to the given stream, so that parallel runs can report them in order.
+  auto generate_file(const std::string& source_file_path,
+                     const std::string& output_file_path,
+                     kiste::compiler_options opts,
+                     std::ostream& errors,
+                     std::vector<std::string>& dependencies) -> bool
+  {
+    std::ifstream is{source_file_path};
+    if (not is)
     {
-      return {pos, segment_type::text, "$"};
+      errors << "Could not open " << source_file_path << std::endl;
+      return false;
     }
-    else if (line.at(pos) == '%')
+    // Only the scans need the whole source in memory, the template itself is compiled from the file
+    if (not opts._instantiations.empty() or opts._fuse_static_calls)
     {
-      return {pos, segment_type::text, "%"};
+      auto source = std::string{};
+      if (not read_file(source_file_path, source))
+      {
+        errors << "Could not open " << source_file_path << std::endl;
+        return false;
+      }
+      collect_known_classes(source_file_path, source, opts, opts._known_classes, dependencies);
     }
-    else if (line.at(pos) == '|')
+
+    // Output to stdout is buffered, so that a failing template does not leave a partial header
+    // behind when redirected to a file. Files are streamed into a temporary file instead.
+    std::ostringstream buffer;
+    std::ostream* os = &buffer;
+    std::ofstream ofs;
+    const auto temporary_file_path = kiste::temporary_path(output_file_path);
+    if (not output_file_path.empty())
     {
-      if (pos != line.size() - 1)
+      ofs.open(temporary_file_path, std::ios::out);
+      if (not ofs)
       {
-        throw parse_error("Trailing characters after trim-right ($|)");
+        errors << "Could not open output file " << temporary_file_path << std::endl;
+        return false;
       }
-      return {pos, segment_type::trim_trailing_return, ""};
+
+      os = &ofs;
     }
-    else if (line.at(pos) == '{')
+
+    const auto result = kiste::compile(is, *os, source_file_path, opts);
+    for (const auto& d : result._diagnostics)
     {
-      return parse_expression(line, segment_type::escape, pos + 1);
+      report_diagnostic(errors, d);
     }
-    else if (line.substr(pos, 4) == "raw{")
+    if (not result._success)
     {
-      return parse_expression(line, segment_type::raw, pos + 4);
+      if (not output_file_path.empty())
+      {
+        ofs.close();
+        std::remove(temporary_file_path.c_str());
+      }
+      return false;
     }
-    else if (line.substr(pos, 5) == "call{")
+
+    if (output_file_path.empty())
     {
-      return parse_expression(line, segment_type::call, pos + 5);
+      std::cout << buffer.str();
     }
     else
     {
-      throw parse_error("Unknown command: " + line.substr(pos));
+      ofs.close();
+      if (not ofs)
+      {
+        errors << "Could not write output file " << temporary_file_path << std::endl;
+        return false;
+      }
+      if (kiste::replace_if_changed(temporary_file_path, output_file_path) ==
+          kiste::replace_result::failed)
+      {
+        errors << "Could not replace output file " << output_file_path << std::endl;
+        return false;
+      }
     }
+    if (not opts._instantiations.empty() and
+        not write_instantiation_file(instantiation_file_path(output_file_path),
+                                     output_file_path,
+                                     result._instantiation_definitions))
+    {
+      errors << "Could not write " << instantiation_file_path(output_file_path) << std::endl;
+      return false;
+    }
+    collect_dependencies(source_file_path, result, output_file_path, dependencies);
+    return true;
   }
 
-  auto parse_text_line(const parse_context& ctx, const std::string& line) -> line_data_t
+  // Generates all headers into output_dir, using up to `jobs` threads. Each template gets its own
+  // output file and error report, and reports are printed in the order of the input files, so the
+  // result does not depend on scheduling.
+  auto generate_files(const std::vector<std::string>& source_file_paths,
+                      const std::string& output_dir,
+                      const std::string& depfile_path,
+                      const kiste::compiler_options& opts,
+                      std::vector<std::string> all_dependencies,
+                      std::size_t jobs) -> int
   {
-    if (ctx._curly_level <= ctx._class_curly_level)
-      throw parse_error("Unexpected text outside of member function");
-
-    auto text_line = line_data_t{line_type::text, {}};
-    for (std::size_t pos = 0; pos < line.size(); ++pos)
+    auto output_file_paths = std::vector<std::string>{};
+    for (const auto& source_file_path : source_file_paths)
     {
-      switch (line.at(pos))
-      {
-      case '$':
+      const auto output_file_path = output_dir + "/" + output_file_name(source_file_path);
+      if (std::find(output_file_paths.begin(), output_file_paths.end(), output_file_path) !=
+          output_file_paths.end())
       {
-        pos = text_line.add_segment(parse_command(line, ++pos));
-        break;
-      }
-      default:
-        text_line.add_character(line.at(pos));
-        break;
+        std::cerr << "ERROR: More than one input would be written to " << output_file_path
+                  << std::endl;
+        return 1;
       }
+      output_file_paths.push_back(output_file_path);
     }
 
-    return text_line;
-  }
+    auto reports = std::vector<std::string>(source_file_paths.size());
+    auto dependencies = std::vector<std::vector<std::string>>(source_file_paths.size());
+    auto succeeded = std::vector<char>(source_file_paths.size(), false);
+    std::atomic<std::size_t> next_index{0};
 
-  auto parse_parent_class(const std::string& line) -> std::string
-  {
-    const auto colonPos = line.find_first_not_of(" \t");
-    if (colonPos == line.npos)
+    auto work = [&]()
     {
-      return "";
-    }
-    if (line[colonPos] != ':')
+      for (auto i = next_index++; i < source_file_paths.size(); i = next_index++)
+      {
+        std::ostringstream errors;
+        succeeded[i] = generate_file(
+            source_file_paths[i], output_file_paths[i], opts, errors, dependencies[i]);
+        reports[i] = errors.str();
+      }
+    };
+
+    jobs = std::min(std::max(jobs, std::size_t{1}), source_file_paths.size());
+    auto threads = std::vector<std::thread>{};
+    for (std::size_t i = 1; i < jobs; ++i)
     {
-      throw parse_error("Unexpected character after class name, did you forget a ':'?");
+      threads.emplace_back(work);
     }
-    const auto nameBegin = line.find_first_not_of(" \t", colonPos + 1);
-    if (nameBegin == line.npos)
+    work();
+    for (auto& thread : threads)
     {
-      throw parse_error("Could not find parent class name");
+      thread.join();
     }
-    const auto nameEnd = line.find_first_of(" \t", nameBegin);
-    const auto parent_name = (nameEnd == line.npos) ? line.substr(nameBegin)
-                                                    : line.substr(nameBegin, nameEnd - nameBegin);
 
-    if (nameEnd != line.npos and line.find_first_not_of(" \t", nameEnd) != line.npos)
+    auto result = 0;
+    for (std::size_t i = 0; i < source_file_paths.size(); ++i)
     {
-      throw parse_error("Unexpected trailing characters after parent class name");
+      std::cerr << reports[i];
+      if (not succeeded[i])
+      {
+        result = 1;
+      }
+      for (const auto& dependency : dependencies[i])
+      {
+        if (std::find(all_dependencies.begin(), all_dependencies.end(), dependency) ==
+                all_dependencies.end() and
+            std::find(output_file_paths.begin(), output_file_paths.end(), dependency) ==
+                output_file_paths.end())
+        {
+          all_dependencies.push_back(dependency);
+        }
+      }
     }
 
-    return parent_name;
-  }
-
-  auto parse_class_member(const parse_context& ctx, const std::string& line) -> member_t
-  {
-    if (not ctx._class_curly_level)
+    auto targets = output_file_paths;
+    if (not opts._instantiations.empty())
     {
-      throw parse_error("Cannot add a member here, did you forget to call $class?");
+      for (const auto& output_file_path : output_file_paths)
+      {
+        targets.push_back(instantiation_file_path(output_file_path));
+      }
     }
-    const auto classBegin = line.find_first_not_of(" \t", std::strlen("member"));
-    if (classBegin == line.npos)
-      throw parse_error("Could not find member class name");
-    const auto classEnd = line.find_first_of(" \t", classBegin);
-    if (classEnd == line.npos)
-      throw parse_error("Could not find member name");
-
-    const auto member_class_name = line.substr(classBegin, classEnd - classBegin);
-
-    const auto nameBegin = line.find_first_not_of(" \t", classEnd);
-    if (nameBegin == line.npos)
-      throw parse_error("Could not find member name");
-    const auto nameEnd = line.find_first_of(" \t", nameBegin);
-
-    const auto member_name = (nameEnd == line.npos) ? line.substr(nameBegin)
-                                                    : line.substr(nameBegin, nameEnd - nameBegin);
-
-    if (line.find_first_not_of(" \t", nameEnd) != line.npos)
+    if (result == 0 and not depfile_path.empty() and
+        not kiste::write_depfile(depfile_path, targets, all_dependencies))
     {
-      throw parse_error("unexpected characters after member declaration");
+      std::cerr << "Could not write depfile " << depfile_path << std::endl;
+      result = 1;
     }
-
-    return {member_class_name, member_name};
+    return result;
   }
 
-  auto parse_class(const parse_context& ctx, const std::string& line) -> class_t
+  auto is_template(const std::string& name) -> bool
   {
-    if (ctx._class_curly_level)
-      throw parse_error("Cannot open new class here, did you forget to call $endclass?");
-    const auto nameBegin = line.find_first_not_of(" \t", std::strlen("class"));
-    if (nameBegin == line.npos)
-      throw parse_error("Could not find class name");
-    const auto nameEnd = line.find_first_of(" \t", nameBegin);
-
-    auto cd = class_t{};
-    cd._name = (nameEnd == line.npos) ? line.substr(nameBegin)
-                                      : line.substr(nameBegin, nameEnd - nameBegin);
-    if (nameEnd != line.npos)
-    {
-      cd._parent_name = parse_parent_class(line.substr(nameEnd));
-    };
-
-    return cd;
+    const auto extension = std::string{".kiste"};
+    return name.size() > extension.size() and
+           name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
   }
 
-  auto parse_line(const parse_context& ctx) -> line_data_t
+  // Generates all templates in source_dir and then regenerates each template whenever it is
+  // saved. The last generated code of each template is kept, so headers are only written if the
+  // generated code actually changes.
+  auto watch(const std::string& source_dir,
+             const std::string& output_dir,
+             const kiste::compiler_options& opts) -> int
   {
-    const auto pos_first_char = ctx._line.find_first_not_of(" \t");
-    if (pos_first_char == ctx._line.npos)
+    auto generated_code = std::map<std::string, std::string>{};
+
+    auto regenerate = [&](const std::string& name)
     {
-      if (ctx._class_curly_level and ctx._curly_level > ctx._class_curly_level)
+      if (not is_template(name))
+        return;
+
+      const auto start = std::chrono::steady_clock::now();
+      const auto source_file_path = source_dir + "/" + name;
+      const auto output_file_path = output_dir + "/" + output_file_name(name);
+      std::ifstream ifs{source_file_path};
+      if (not ifs)
       {
-        return parse_text_line(ctx, ctx._line);
+        std::cerr << "Could not open " << source_file_path << std::endl;
+        return;
       }
-      else
+      std::ostringstream source;
+      source << ifs.rdbuf();
+
+      auto template_opts = opts;
+      if (opts._fuse_static_calls)
       {
-        return line_data_t{};
+        auto dependencies = std::vector<std::string>{};
+        collect_known_classes(
+            source_file_path, source.str(), opts, template_opts._known_classes, dependencies);
       }
-    }
-    else
-    {
-      const auto rest = ctx._line.substr(pos_first_char + 1);
-      switch (ctx._line.at(pos_first_char))
+      const auto result = kiste::compile(source.str(), source_file_path, template_opts);
+      for (const auto& d : result._diagnostics)
       {
-      case '%':  // cpp line
-        return line_data_t{line_type::cpp,
-                           std::vector<segment_t>{{0,
-                                                   segment_type::cpp,
-                                                   ctx._line.substr(0, pos_first_char) +
-                                                       ctx._line.substr(pos_first_char + 1)}}};
-        break;
-      case '$':  // opening / closing class or text line
-        if (starts_with(rest, "class"))
-        {
-          return {parse_class(ctx, rest)};
-        }
-        else if (starts_with(rest, "endclass"))
-        {
-          return {line_type::class_end, {}};
-        }
-        else if (starts_with(rest, "member"))
-        {
-          return parse_class_member(ctx, rest);
-        }
-        else if (starts_with(rest, "|"))  // trim left
+        report_diagnostic(std::cerr, d);
+      }
+      if (not result._success)
+        return;
+
+      auto& code = generated_code[source_file_path];
+      auto status = "unchanged";
+      if (code != result._code)
+      {
+        const auto temporary_file_path = kiste::temporary_path(output_file_path);
+        std::ofstream ofs{temporary_file_path};
+        ofs << result._code;
+        ofs.close();
+        if (not ofs)
         {
-          return parse_text_line(ctx, ctx._line.substr(pos_first_char + 2));
+          std::cerr << "Could not write output file " << temporary_file_path << std::endl;
+          return;
         }
-        else
+        switch (kiste::replace_if_changed(temporary_file_path, output_file_path))
         {
-          return parse_text_line(ctx, ctx._line);
+        case kiste::replace_result::unchanged:
+          break;
+        case kiste::replace_result::replaced:
+          status = "written";
+          break;
+        case kiste::replace_result::failed:
+          std::cerr << "Could not replace output file " << output_file_path << std::endl;
+          return;
         }
-        break;
-      default:
-        return parse_text_line(ctx, ctx._line);
+        code = result._code;
       }
-    }
-  }
 
-  auto parse(parse_context& ctx) -> std::vector<line_t>
-  {
-    auto lines = std::vector<line_t>{};
+      const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start);
+      std::cout << output_file_path << ": " << status << " (" << duration.count() / 1000.0
+                << " ms)" << std::endl;
+    };
 
-    while (ctx._is.good())
+    auto regenerate_all = [&]()
     {
-      ++ctx._line_no;
-      getline(ctx._is, ctx._line);
-
-      const auto line_data = parse_line(ctx);
-      ctx.update(line_data);
-      lines.push_back({ctx, line_data});
-
-      if (lines.size() > 2)
+      auto names = kiste::list_directory(source_dir);
+      std::sort(names.begin(), names.end());
+      for (const auto& name : names)
       {
-        auto& line = lines.at(lines.size() - 1);
-        auto& previous_line = lines.at(lines.size() - 2);
-        line._previous_line_ends_with_text = previous_line.ends_with_text();
-        previous_line._next_line_starts_with_text = line.starts_with_text();
+        regenerate(name);
       }
-    }
-    if (not lines.empty() and lines.back()._curly_level)
-    {
-      throw parse_error("not enough closing curly braces");
-    }
-
-    return lines;
-  }
-
-  auto write(const parse_context& ctx, const std::vector<line_t>& lines) -> void
-  {
-    auto serializer = ::kiste::cpp(ctx._os);
-    auto kissTemplate = ::kiste::KisteTemplate(ctx, serializer);
-    auto classTemplate = ::kiste::ClassTemplate(ctx, serializer);
-    auto lineTemplate = ::kiste::LineTemplate(ctx, serializer);
-
-    auto class_data = class_t{};
+    };
 
-    kissTemplate.render_header();
-    auto line_no = std::size_t{0};
-    for (const auto& line : lines)
-    {
-      ++line_no;
-      switch (line._type)
-      {
-      case line_type::none:
-        lineTemplate.render_none();
-        break;
-      case line_type::cpp:
-        lineTemplate.render_cpp(line);
-        break;
-      case line_type::text:
-        lineTemplate.render_text(line);
-        break;
-      case line_type::class_begin:
-        class_data = line._class_data;
-        classTemplate.render_header(line_no, class_data);
-        break;
-      case line_type::member:
-        classTemplate.render_member(line_no, class_data, line._member);
-        break;
-      case line_type::class_end:
-        classTemplate.render_footer(line_no, class_data);
-        break;
-      }
-    }
-    kissTemplate.render_footer();
+    // Generating only after the watch is set up makes sure that no save is missed.
+    // Fused calls copy text from other templates, so any change may affect all of them
+    return kiste::watch_directory(source_dir,
+                                  regenerate_all,
+                                  [&](const std::string& name)
+                                  {
+                                    if (opts._fuse_static_calls and is_template(name))
+                                      regenerate_all();
+                                    else
+                                      regenerate(name);
+                                  })
+               ? 0
+               : 1;
   }
 }
 
@@ -366,17 +576,30 @@ auto usage(std::string reason = "") -> int
   if (not reason.empty())
     std::cerr << "ERROR: " << reason << std::endl;
 
-  std::cerr << "Usage: kiste2cpp [--output OUTPUT_HEADER_FILENAME] [--report-exceptions] "
-               "[--no-line-directives] SOURCE_FILENAME" << std::endl;
+  std::cerr << "Usage: kiste2cpp [OPTION]... [--output OUTPUT_HEADER_FILENAME [--depfile DEPFILE]] "
+               "SOURCE_FILENAME" << std::endl;
+  std::cerr << "       kiste2cpp [OPTION]... --output-dir OUTPUT_DIRECTORY [--depfile DEPFILE] "
+               "[--jobs N] SOURCE_FILENAME..." << std::endl;
+  std::cerr << "       kiste2cpp [OPTION]... --watch SOURCE_DIRECTORY --output-dir OUTPUT_DIRECTORY"
+            << std::endl;
+  std::cerr << "Options: --report-exceptions --report-exceptions-per-function "
+               "--no-line-directives --fast-compile" << std::endl;
+  std::cerr << "         --report-errors --fuse-static-calls" << std::endl;
+  std::cerr << "         --instantiate \"DATA_TYPE, SERIALIZER_TYPE\" --instantiations FILE"
+            << std::endl;
   return 1;
 }
 
 auto main(int argc, char** argv) -> int
 {
-  auto source_file_path = std::string{};
+  auto source_file_paths = std::vector<std::string>{};
   auto output_file_path = std::string{};
-  auto report_exceptions = false;
-  auto line_directives = true;
+  auto output_dir = std::string{};
+  auto depfile_path = std::string{};
+  auto watch_dir = std::string{};
+  auto dependencies = std::vector<std::string>{};
+  auto jobs = std::size_t{std::thread::hardware_concurrency()};
+  auto opts = kiste::compiler_options{};
 
   for (int i = 1; i < argc; ++i)
   {
@@ -392,61 +615,153 @@ auto main(int argc, char** argv) -> int
         return usage("No output file given, or given twice");
       }
     }
+    else if (std::string{argv[i]} == "--output-dir")
+    {
+      if (i + 1 < argc and output_dir.empty())
+      {
+        output_dir = argv[i + 1];
+        ++i;
+      }
+      else
+      {
+        return usage("No output directory given, or given twice");
+      }
+    }
+    else if (std::string{argv[i]} == "--depfile")
+    {
+      if (i + 1 < argc and depfile_path.empty())
+      {
+        depfile_path = argv[i + 1];
+        ++i;
+      }
+      else
+      {
+        return usage("No depfile given, or given twice");
+      }
+    }
+    else if (std::string{argv[i]} == "--watch")
+    {
+      if (i + 1 < argc and watch_dir.empty())
+      {
+        watch_dir = argv[i + 1];
+        ++i;
+      }
+      else
+      {
+        return usage("No directory to watch given, or given twice");
+      }
+    }
+    else if (std::string{argv[i]} == "--jobs")
+    {
+      if (i + 1 < argc and std::atoi(argv[i + 1]) > 0)
+      {
+        jobs = std::atoi(argv[i + 1]);
+        ++i;
+      }
+      else
+      {
+        return usage("--jobs requires a positive number");
+      }
+    }
     else if (std::string{argv[i]} == "--report-exceptions")
     {
-      report_exceptions = true;
+      opts._report_exceptions = true;
+    }
+    else if (std::string{argv[i]} == "--report-exceptions-per-function")
+    {
+      opts._report_exceptions_per_function = true;
+    }
+    else if (std::string{argv[i]} == "--report-errors")
+    {
+      opts._report_errors = true;
     }
     else if (std::string{argv[i]} == "--no-line-directives")
     {
-      line_directives = false;
+      opts._line_directives = false;
+    }
+    else if (std::string{argv[i]} == "--fast-compile")
+    {
+      opts._fast_compile = true;
     }
-    else if (source_file_path.empty())
+    else if (std::string{argv[i]} == "--fuse-static-calls")
     {
-      source_file_path = argv[i];
+      opts._fuse_static_calls = true;
+    }
+    else if (std::string{argv[i]} == "--instantiate")
+    {
+      auto inst = kiste::instantiation{};
+      if (i + 1 < argc and parse_instantiation(argv[i + 1], inst))
+      {
+        opts._instantiations.push_back(inst);
+        ++i;
+      }
+      else
+      {
+        return usage("--instantiate requires \"DATA_TYPE, SERIALIZER_TYPE\"");
+      }
+    }
+    else if (std::string{argv[i]} == "--instantiations")
+    {
+      if (i + 1 < argc and read_instantiations(argv[i + 1], opts))
+      {
+        dependencies.push_back(argv[i + 1]);
+        ++i;
+      }
+      else
+      {
+        return usage("--instantiations requires a readable file");
+      }
     }
     else
     {
-      return usage(std::string{"Extra argument: "} + argv[i]);
+      source_file_paths.push_back(argv[i]);
     }
   }
 
-  if (source_file_path.empty())
-    return usage("No input file given");
-
-  std::ifstream ifs{source_file_path};
-  if (not ifs)
+  if (not watch_dir.empty())
   {
-    std::cerr << "Could not open " << source_file_path << std::endl;
-    return 1;
+    if (output_dir.empty() or not output_file_path.empty() or not depfile_path.empty() or
+        not opts._instantiations.empty())
+      return usage("--watch requires --output-dir and cannot be combined with --output, "
+                   "--depfile or --instantiate");
+    if (not source_file_paths.empty())
+      return usage(std::string{"Extra argument: "} + source_file_paths.front());
+
+    return watch(watch_dir, output_dir, opts);
   }
 
-  std::ostream* os = &std::cout;
-  std::ofstream ofs;
-  if (not output_file_path.empty())
+  if (source_file_paths.empty())
+    return usage("No input file given");
+
+  if (not output_dir.empty())
   {
-    ofs.open(output_file_path, std::ios::out);
-    if (not ofs)
-    {
-      std::cerr << "Could not open output file " << output_file_path << std::endl;
-      return 1;
-    }
+    if (not output_file_path.empty())
+      return usage("--output and --output-dir cannot be combined");
 
-    os = &ofs;
+    return generate_files(source_file_paths, output_dir, depfile_path, opts, dependencies, jobs);
   }
 
-  auto ctx = kiste::parse_context{ifs, *os, source_file_path, report_exceptions, line_directives};
+  if (source_file_paths.size() > 1)
+    return usage(std::string{"Extra argument: "} + source_file_paths[1]);
+
+  if (not depfile_path.empty() and output_file_path.empty())
+    return usage("--depfile requires --output");
+
+  if (not opts._instantiations.empty() and output_file_path.empty())
+    return usage("--instantiate requires --output or --output-dir");
+
+  if (not generate_file(source_file_paths.front(), output_file_path, opts, std::cerr, dependencies))
+    return 1;
 
-  try
+  auto targets = std::vector<std::string>{output_file_path};
+  if (not opts._instantiations.empty())
   {
-    const auto lines = kiste::parse(ctx);
-    kiste::write(ctx, lines);
+    targets.push_back(instantiation_file_path(output_file_path));
   }
-  catch (const kiste::parse_error& e)
+  if (not depfile_path.empty() and not kiste::write_depfile(depfile_path, targets, dependencies))
   {
-    std::cerr << "Parse error in file: " << ctx._filename << std::endl;
-    std::cerr << "Line number: " << ctx._line_no << std::endl;
-    std::cerr << "Message: " << e.what() << std::endl;
-    std::cerr << "Line: " << ctx._line << std::endl;
+    std::cerr << "Could not write depfile " << depfile_path << std::endl;
     return 1;
   }
+  return 0;
 }
@@ -73,7 +73,17 @@ namespace kiste
 
   line_t::line_t(const parse_context& ctx, const line_data_t& line_data) : line_data_t(line_data)
   {
+    _line_no = ctx._line_no;
     _curly_level = ctx._curly_level;
+    // Chunks of a $parallel_for are rendered in a lambda, possibly in another thread. They report
+    // exceptions per expression, errors do not end the rendering and they cannot suspend.
+    // The same holds for lambdas and local classes in the member function.
+    const auto nested =
+        not ctx._parallel_for_levels.empty() or not ctx._nested_functions.empty();
+    _function_reports_exceptions = ctx._function_reports_exceptions and not nested;
+    _function_returns_void = ctx._function_returns_void and not nested;
+    _function_pulls = ctx._function_pulls and not nested;
+    _exception_handlers = ctx._exception_handlers;
     if (_type == line_type::text)
     {
       enforce_at_least_one_segment();
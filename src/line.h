@@ -39,16 +39,32 @@ namespace kiste
     std::string _text;
   };
 
+  // Position in a C++ line at which an exception handler for a member function opens or closes
+  struct exception_handler_t
+  {
+    std::size_t _pos;
+    bool _open;
+  };
+
   struct member_t
   {
     std::string class_name;
     std::string name;
   };
 
+  // Declaration and range of `$parallel_for (declaration : range)`
+  struct parallel_for_t
+  {
+    std::string _declaration;
+    std::string _range;
+  };
+
   struct class_t
   {
     std::string _name;
     std::string _parent_name;
+    std::string _namespace;
+    bool _at_namespace_scope = false;
   };
 
   struct parse_context;
@@ -60,10 +76,13 @@ namespace kiste
     std::vector<segment_t> _segments;
     class_t _class_data;
     member_t _member;
+    parallel_for_t _parallel_for;
 
     line_data_t() = default;
     line_data_t(const line_data_t&) = default;
     line_data_t(line_data_t&&) = default;
+    line_data_t& operator=(const line_data_t&) = default;
+    line_data_t& operator=(line_data_t&&) = default;
 
     line_data_t(line_type type) : _type(type)
     {
@@ -82,6 +101,11 @@ namespace kiste
     {
     }
 
+    line_data_t(const parallel_for_t& data)
+        : _type(line_type::parallel_for_begin), _parallel_for(data)
+    {
+    }
+
     auto add_character(const char c) -> void;
     auto add_segment(const segment_t& segment) -> size_t;
 
@@ -92,10 +116,16 @@ namespace kiste
 
   struct line_t : public line_data_t
   {
+    std::size_t _line_no = 0;
     std::size_t _curly_level = 0;
     bool _previous_line_ends_with_text = false;
     bool _next_line_starts_with_text = false;
+    bool _function_reports_exceptions = false;
+    bool _function_returns_void = false;
+    bool _function_pulls = false;
+    std::vector<exception_handler_t> _exception_handlers;
 
+    line_t() = default;
     line_t(const parse_context& ctx, const line_data_t& line_data);
 
     auto ends_with_text() const -> bool;
@@ -35,5 +35,7 @@ namespace kiste
     class_begin,
     class_end,
     member,
+    parallel_for_begin,
+    parallel_for_end,
   };
 }
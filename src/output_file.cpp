@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include "output_file.h"
+
+namespace kiste
+{
+  namespace
+  {
+    auto have_same_content(const std::string& lhs_path, const std::string& rhs_path) -> bool
+    {
+      std::ifstream lhs{lhs_path, std::ios::binary};
+      std::ifstream rhs{rhs_path, std::ios::binary};
+      if (not lhs or not rhs)
+      {
+        return false;
+      }
+
+      char lhs_buffer[4096];
+      char rhs_buffer[4096];
+      while (lhs and rhs)
+      {
+        lhs.read(lhs_buffer, sizeof(lhs_buffer));
+        rhs.read(rhs_buffer, sizeof(rhs_buffer));
+        if (lhs.gcount() != rhs.gcount() or
+            not std::equal(lhs_buffer, lhs_buffer + lhs.gcount(), rhs_buffer))
+        {
+          return false;
+        }
+      }
+      return lhs.eof() and rhs.eof();
+    }
+
+    auto escape_depfile_path(const std::string& path) -> std::string
+    {
+      auto escaped = std::string{};
+      for (const auto c : path)
+      {
+        switch (c)
+        {
+        case ' ':
+        case '#':
+          escaped.push_back('\\');
+          break;
+        case '$':
+          escaped.push_back('$');
+          break;
+        default:
+          break;
+        }
+        escaped.push_back(c);
+      }
+      return escaped;
+    }
+  }
+
+  auto temporary_path(const std::string& path) -> std::string
+  {
+    return path + ".kiste2cpp.tmp";
+  }
+
+  auto replace_if_changed(const std::string& temporary_path, const std::string& path)
+      -> replace_result
+  {
+    if (have_same_content(temporary_path, path))
+    {
+      std::remove(temporary_path.c_str());
+      return replace_result::unchanged;
+    }
+
+    if (std::rename(temporary_path.c_str(), path.c_str()) == 0)
+    {
+      return replace_result::replaced;
+    }
+
+    // std::rename does not replace existing files on all platforms. The old file is moved aside
+    // and only removed once the new one is in place.
+    if (errno == EEXIST or errno == EACCES)
+    {
+      const auto old_path = path + ".kiste2cpp.old";
+      std::remove(old_path.c_str());
+      if (std::rename(path.c_str(), old_path.c_str()) == 0)
+      {
+        if (std::rename(temporary_path.c_str(), path.c_str()) == 0)
+        {
+          std::remove(old_path.c_str());
+          return replace_result::replaced;
+        }
+        std::rename(old_path.c_str(), path.c_str());
+      }
+    }
+    std::remove(temporary_path.c_str());
+    return replace_result::failed;
+  }
+
+  auto write_depfile(const std::string& depfile_path,
+                     const std::vector<std::string>& targets,
+                     const std::vector<std::string>& dependencies) -> bool
+  {
+    std::ofstream os{temporary_path(depfile_path)};
+    if (not os)
+    {
+      return false;
+    }
+
+    auto separator = "";
+    for (const auto& target : targets)
+    {
+      os << separator << escape_depfile_path(target);
+      separator = " ";
+    }
+    os << ":";
+    for (const auto& dependency : dependencies)
+    {
+      os << " \\\n  " << escape_depfile_path(dependency);
+    }
+    os << "\n";
+    os.close();
+
+    return replace_if_changed(temporary_path(depfile_path), depfile_path) !=
+           replace_result::failed;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+#include <vector>
+
+namespace kiste
+{
+  // Path of the temporary file that output is written to before it replaces the real output
+  auto temporary_path(const std::string& path) -> std::string;
+
+  enum class replace_result
+  {
+    unchanged,
+    replaced,
+    failed
+  };
+
+  // Moves the temporary file to path, unless path already has the very same content. In that case
+  // the temporary file is removed and path keeps its timestamp, so nothing that depends on it gets
+  // rebuilt. If the temporary file cannot be moved, it is removed and path is left as it was.
+  auto replace_if_changed(const std::string& temporary_path, const std::string& path)
+      -> replace_result;
+
+  // Writes a Makefile/Ninja style depfile with one rule for all targets
+  auto write_depfile(const std::string& depfile_path,
+                     const std::vector<std::string>& targets,
+                     const std::vector<std::string>& dependencies) -> bool;
+}
@@ -25,6 +25,8 @@
  */
 
 #include <ciso646>  // Make MSCV understand and/or/not
+#include <cctype>
+#include <sstream>
 #include "parse_context.h"
 #include "line.h"
 
@@ -36,8 +38,15 @@ namespace kiste
         -> std::size_t
     {
       auto level = ctx._curly_level;
-      if (line_data._type != line_type::cpp)
+      switch (line_data._type)
       {
+      case line_type::cpp:
+        break;
+      case line_type::parallel_for_begin:
+        return level + 1;
+      case line_type::parallel_for_end:
+        return level - 1;  // balanced, see determine_parallel_for
+      default:
         return level;
       }
 
@@ -60,6 +69,436 @@ namespace kiste
       return level;
     }
 
+    auto is_identifier_char(char c) -> bool
+    {
+      return std::isalnum(static_cast<unsigned char>(c)) or c == '_';
+    }
+
+    auto contains_word(const std::string& text, const std::string& word) -> bool
+    {
+      for (auto pos = text.find(word); pos != text.npos; pos = text.find(word, pos + 1))
+      {
+        const auto end = pos + word.size();
+        if ((pos == 0 or not is_identifier_char(text[pos - 1])) and
+            (end == text.size() or not is_identifier_char(text[end])))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Only non-static member functions returning void get a handler per function. Everything
+    // else (e.g. lambdas, nested types or functions that need to return a value) keeps the
+    // handlers per expression.
+    auto declares_void_member_function(const std::string& declaration) -> bool
+    {
+      const auto paren = declaration.find('(');
+      if (paren == declaration.npos or declaration.find_first_of("=[") < paren or
+          contains_word(declaration, "static"))
+      {
+        return false;
+      }
+      const auto arrow = declaration.find("->", paren);
+      if (arrow != declaration.npos)
+      {
+        const auto type_begin = declaration.find_first_not_of(" \t", arrow + 2);
+        return type_begin != declaration.npos and
+               contains_word(declaration.substr(type_begin, 5), "void");
+      }
+      return contains_word(declaration.substr(0, paren), "void");
+    }
+
+    // Member functions returning kiste::pull_task are coroutines, which may suspend after text
+    auto declares_pull_member_function(const std::string& declaration) -> bool
+    {
+      const auto paren = declaration.find('(');
+      if (paren == declaration.npos or declaration.find_first_of("=[") < paren or
+          contains_word(declaration, "static"))
+      {
+        return false;
+      }
+      const auto arrow = declaration.find("->", paren);
+      return contains_word(arrow != declaration.npos ? declaration.substr(arrow + 2)
+                                                     : declaration.substr(0, paren),
+                           "pull_task");
+    }
+
+    // Lambdas and local classes in a member function are nested functions, which may run after the
+    // member function returned. A '[' following an expression is a subscript, "[[" an attribute.
+    auto declares_nested_function(const std::string& declaration) -> bool
+    {
+      if (contains_word(declaration, "struct") or contains_word(declaration, "class") or
+          contains_word(declaration, "union"))
+      {
+        return true;
+      }
+      for (auto pos = declaration.find('['); pos != declaration.npos;
+           pos = declaration.find('[', pos + 1))
+      {
+        if (declaration.compare(pos, 2, "[[") == 0 or (pos > 0 and declaration[pos - 1] == '['))
+        {
+          continue;
+        }
+        const auto previous = pos == 0 ? declaration.npos
+                                       : declaration.find_last_not_of(" \t", pos - 1);
+        if (previous == declaration.npos)
+        {
+          return true;
+        }
+        const auto c = declaration[previous];
+        if (is_identifier_char(c))
+        {
+          if (previous >= 5 and declaration.compare(previous - 5, 6, "return") == 0 and
+              (previous == 5 or not is_identifier_char(declaration[previous - 6])))
+          {
+            return true;
+          }
+        }
+        else if (c != ')' and c != ']')
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    auto declares_loop(const std::string& declaration) -> bool
+    {
+      return contains_word(declaration, "for") or contains_word(declaration, "while") or
+             contains_word(declaration, "do") or contains_word(declaration, "switch");
+    }
+
+    // The body of a $parallel_for is rendered in chunks, each in a loop of its own. So break and
+    // return would only end the current chunk, unless they belong to a loop or lambda in the body.
+    auto check_parallel_for_statement(const parse_context& ctx) -> void
+    {
+      auto in_loop = false;
+      auto in_function = false;
+      for (auto it = ctx._body_scopes.rbegin();
+           it != ctx._body_scopes.rend() and *it != body_scope::parallel_for;
+           ++it)
+      {
+        in_loop = in_loop or *it == body_scope::loop;
+        in_function = in_function or *it == body_scope::function;
+      }
+      if (not in_function and contains_word(ctx._declaration, "return"))
+        throw parse_error("return cannot be used in $parallel_for");
+      if (not in_function and not in_loop and contains_word(ctx._declaration, "break") and
+          not declares_loop(ctx._declaration))
+        throw parse_error("break cannot be used in $parallel_for");
+    }
+
+    auto open_body_scope(parse_context& ctx) -> void
+    {
+      auto scope = body_scope::block;
+      if (declares_nested_function(ctx._declaration))
+        scope = body_scope::function;
+      else if (declares_loop(ctx._declaration))
+        scope = body_scope::loop;
+      ctx._body_scopes.push_back(scope);
+    }
+
+    // Name of a function declared without parameters, e.g. "body" for "auto body() -> void".
+    // Returns an empty string for everything else.
+    auto function_name(const std::string& declaration, bool& has_parameters) -> std::string
+    {
+      const auto paren = declaration.find('(');
+      if (paren == declaration.npos or declaration.find('=') < paren or
+          contains_word(declaration, "operator"))
+      {
+        return "";
+      }
+      const auto end = declaration.find_last_not_of(" \t", paren == 0 ? 0 : paren - 1);
+      if (end == declaration.npos or not is_identifier_char(declaration[end]))
+      {
+        return "";
+      }
+      auto begin = end;
+      while (begin > 0 and is_identifier_char(declaration[begin - 1]))
+      {
+        --begin;
+      }
+      const auto next = declaration.find_first_not_of(" \t", paren + 1);
+      has_parameters = next == declaration.npos or declaration[next] != ')';
+      return declaration.substr(begin, end - begin + 1);
+    }
+
+    // A member function emits nothing but text, if it takes no arguments and its body consists
+    // of text lines without any commands
+    auto begin_function(parse_context& ctx) -> void
+    {
+      auto has_parameters = true;
+      ctx._in_function = true;
+      ctx._function = function_info{};
+      ctx._function._name = function_name(ctx._declaration, has_parameters);
+      ctx._function._static_text = not has_parameters and
+                                   declares_void_member_function(ctx._declaration) and
+                                   not contains_word(ctx._declaration, "template");
+      ctx._function_returns_void = declares_void_member_function(ctx._declaration);
+      ctx._function_pulls = declares_pull_member_function(ctx._declaration);
+    }
+
+    auto end_function(parse_context& ctx) -> void
+    {
+      ctx._in_function = false;
+      ctx._function_returns_void = false;
+      ctx._function_pulls = false;
+      if (not ctx._function._static_text)
+      {
+        ctx._function._text.clear();
+      }
+      if (ctx._in_class_info and not ctx._function._name.empty())
+      {
+        ctx._classes.back()._functions.push_back(ctx._function);
+      }
+    }
+
+    // Functions that are declared in the class and defined elsewhere hide those of the parent
+    auto declare_function(parse_context& ctx) -> void
+    {
+      auto has_parameters = true;
+      auto function = function_info{};
+      function._name = function_name(ctx._declaration, has_parameters);
+      if (ctx._in_class_info and not function._name.empty())
+      {
+        ctx._classes.back()._functions.push_back(function);
+      }
+    }
+
+    auto add_function_text(parse_context& ctx, const line_data_t& line_data) -> void
+    {
+      if (not ctx._function._static_text)
+      {
+        return;
+      }
+      for (const auto& segment : line_data._segments)
+      {
+        switch (segment._type)
+        {
+        case segment_type::text:
+          ctx._function._text += segment._text;
+          break;
+        case segment_type::trim_trailing_return:
+          break;
+        default:
+          ctx._function._static_text = false;
+          return;
+        }
+      }
+      if (line_data._segments.empty() or
+          line_data._segments.back()._type != segment_type::trim_trailing_return)
+      {
+        ctx._function._text.push_back('\n');
+      }
+    }
+
+    // Name of the namespace opened by a declaration, empty for anonymous namespaces and "{" for
+    // any other scope
+    auto namespace_name(const std::string& declaration) -> std::string
+    {
+      std::istringstream is{declaration};
+      auto word = std::string{};
+      is >> word;
+      if (word == "inline")
+      {
+        is >> word;
+      }
+      if (word != "namespace")
+      {
+        return "{";
+      }
+      auto name = std::string{};
+      auto rest = std::string{};
+      if (is >> name and is >> rest)
+      {
+        return "{";
+      }
+      return name;
+    }
+
+    // Tracks the C++ in front of each opening curly brace, to determine the namespaces enclosing
+    // classes and where exception handlers of member functions open and close in the current line
+    auto determine_scopes(parse_context& ctx, const line_data_t& line_data) -> void
+    {
+      ctx._exception_handlers.clear();
+      if (line_data._type == line_type::class_begin or line_data._type == line_type::class_end)
+      {
+        ctx._declaration.clear();
+      }
+      if (line_data._type == line_type::text and ctx._in_function)
+      {
+        add_function_text(ctx, line_data);
+      }
+      if (line_data._type != line_type::cpp)
+      {
+        return;
+      }
+
+      const auto& text = line_data._segments.front()._text;
+      const auto first = text.find_first_not_of(" \t");
+      if (not ctx._in_comment and first != text.npos and text[first] == '#')
+      {
+        return;  // preprocessor directive
+      }
+
+      const auto class_level = ctx._class_curly_level;
+      const auto report_per_function = ctx._report_exceptions_per_function and class_level;
+      auto level = ctx._curly_level;
+      auto line_comment = false;
+      for (std::size_t pos = 0; pos < text.size(); ++pos)
+      {
+        switch (text[pos])
+        {
+        case '{':
+          if (not ctx._parallel_for_levels.empty())
+          {
+            open_body_scope(ctx);
+          }
+          if (not class_level)
+          {
+            ctx._scopes.push_back(namespace_name(ctx._declaration));
+          }
+          else if (level == class_level)
+          {
+            begin_function(ctx);
+            if (report_per_function and declares_void_member_function(ctx._declaration))
+            {
+              ctx._exception_handlers.push_back({pos + 1, true});
+              ctx._function_reports_exceptions = true;
+            }
+          }
+          else
+          {
+            ctx._function._static_text = false;
+            if (not ctx._nested_functions.empty() or declares_nested_function(ctx._declaration))
+            {
+              ctx._nested_functions.push_back(level);
+            }
+          }
+          ctx._declaration.clear();
+          ++level;
+          break;
+        case '}':
+          if (level == 0)
+            return;  // reported by determine_curly_level
+          --level;
+          if (not ctx._nested_functions.empty() and ctx._nested_functions.back() == level)
+          {
+            ctx._nested_functions.pop_back();
+          }
+          if (not ctx._parallel_for_levels.empty() and ctx._body_scopes.back() != body_scope::parallel_for)
+          {
+            ctx._body_scopes.pop_back();
+          }
+          if (not class_level and not ctx._scopes.empty())
+          {
+            ctx._scopes.pop_back();
+          }
+          else if (level == class_level)
+          {
+            end_function(ctx);
+            if (ctx._function_reports_exceptions)
+            {
+              ctx._exception_handlers.push_back({pos, false});
+              ctx._function_reports_exceptions = false;
+            }
+          }
+          ctx._declaration.clear();
+          break;
+        default:
+          if (ctx._in_comment)
+          {
+            if (text.compare(pos, 2, "*/") == 0)
+            {
+              ctx._in_comment = false;
+              ++pos;
+            }
+          }
+          else if (line_comment or text.compare(pos, 2, "//") == 0)
+          {
+            line_comment = true;
+          }
+          else if (text.compare(pos, 2, "/*") == 0)
+          {
+            ctx._in_comment = true;
+            ++pos;
+          }
+          else if (text[pos] == ';')
+          {
+            if (not ctx._parallel_for_levels.empty())
+            {
+              check_parallel_for_statement(ctx);
+            }
+            if (class_level and level == class_level)
+            {
+              declare_function(ctx);
+            }
+            ctx._declaration.clear();
+          }
+          else
+          {
+            ctx._declaration.push_back(text[pos]);
+          }
+          if (level > class_level and text[pos] != ' ' and text[pos] != '\t')
+          {
+            ctx._function._static_text = false;  // C++ in the body
+          }
+          break;
+        }
+      }
+      ctx._declaration.push_back(' ');
+    }
+
+    // The body of a $parallel_for is rendered in chunks by separate serializers. Functions called
+    // from there would write to the serializer of the class, though.
+    auto determine_parallel_for(parse_context& ctx, const line_data_t& line_data) -> void
+    {
+      switch (line_data._type)
+      {
+      case line_type::parallel_for_begin:
+        if (ctx._curly_level <= ctx._class_curly_level)
+          throw parse_error("$parallel_for can only be used in member functions");
+        ctx._function._static_text = false;
+        ctx._parallel_for_levels.push_back(ctx._curly_level);
+        ctx._body_scopes.push_back(body_scope::parallel_for);
+        break;
+      case line_type::parallel_for_end:
+        if (ctx._parallel_for_levels.empty())
+          throw parse_error("$endfor without $parallel_for");
+        // Report unbalanced curly braces here rather than at the end of the file
+        if (ctx._curly_level > ctx._parallel_for_levels.back() + 1)
+          throw parse_error("Not enough closing curly braces in $parallel_for");
+        if (ctx._curly_level < ctx._parallel_for_levels.back() + 1)
+          throw parse_error("Too many closing curly braces in $parallel_for");
+        ctx._parallel_for_levels.pop_back();
+        while (ctx._body_scopes.back() != body_scope::parallel_for)
+        {
+          ctx._body_scopes.pop_back();
+        }
+        ctx._body_scopes.pop_back();
+        break;
+      case line_type::class_end:
+        if (not ctx._parallel_for_levels.empty())
+          throw parse_error("Missing $endfor");
+        break;
+      case line_type::text:
+        if (not ctx._parallel_for_levels.empty())
+        {
+          for (const auto& segment : line_data._segments)
+          {
+            if (segment._type == segment_type::call)
+              throw parse_error("$call{} cannot be used in $parallel_for");
+            if (segment._type == segment_type::slot)
+              throw parse_error("$slot{} cannot be used in $parallel_for");
+          }
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
     auto determine_class_curly_level(const parse_context& ctx, const line_data_t& line_data)
         -> std::size_t
     {
@@ -74,6 +513,39 @@ namespace kiste
       }
     }
 
+    auto collect_class_info(parse_context& ctx, const line_data_t& line_data) -> void
+    {
+      switch (line_data._type)
+      {
+      case line_type::class_begin:
+      {
+        const auto& class_data = line_data._class_data;
+        ctx._in_class_info = class_data._at_namespace_scope;
+        if (ctx._in_class_info)
+        {
+          auto info = class_info{};
+          info._namespace = class_data._namespace;
+          info._name = class_data._name;
+          info._parent_name = class_data._parent_name;
+          ctx._classes.push_back(info);
+        }
+        break;
+      }
+      case line_type::member:
+        if (ctx._in_class_info)
+        {
+          ctx._classes.back()._member_class_names.push_back(line_data._member.class_name);
+          ctx._classes.back()._member_names.push_back(line_data._member.name);
+        }
+        break;
+      case line_type::class_end:
+        ctx._in_class_info = false;
+        break;
+      default:
+        break;
+      }
+    }
+
     auto has_trailing_return(const line_data_t& line_data) -> bool
     {
       if (line_data._type == line_type::text and not line_data._segments.empty() and
@@ -85,8 +557,31 @@ namespace kiste
     }
   }
 
+  auto parse_context::is_at_namespace_scope() const -> bool
+  {
+    for (const auto& scope : _scopes)
+    {
+      if (scope.empty() or scope == "{")
+        return false;
+    }
+    return true;
+  }
+
+  auto parse_context::current_namespace() const -> std::string
+  {
+    auto result = std::string{};
+    for (const auto& scope : _scopes)
+    {
+      result += (result.empty() ? "" : "::") + scope;
+    }
+    return result;
+  }
+
   auto parse_context::update(const line_data_t& line_data) -> void
   {
+    collect_class_info(*this, line_data);
+    determine_parallel_for(*this, line_data);
+    determine_scopes(*this, line_data);
     _curly_level = determine_curly_level(*this, line_data);
     _class_curly_level = determine_class_curly_level(*this, line_data);
     _has_trailing_return = ::kiste::has_trailing_return(line_data);
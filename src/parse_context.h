@@ -28,10 +28,20 @@
 #include <stdexcept>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <kiste/compiler.h>
+#include "line.h"
 
 namespace kiste
 {
-  struct line_data_t;
+  // Scopes in the body of a $parallel_for, see determine_parallel_for
+  enum class body_scope
+  {
+    parallel_for,
+    block,
+    loop,  // or switch
+    function
+  };
 
   struct parse_context
   {
@@ -40,26 +50,53 @@ namespace kiste
     std::string _filename;
     bool _report_exceptions = false;
     bool _line_directives = true;
+    bool _report_exceptions_per_function = false;
+    bool _report_errors = false;
+    bool _fast_compile = false;
+    bool _fuse_static_calls = false;
+    const std::vector<class_info>& _known_classes;
     std::string _line;
     std::size_t _line_no = 0;
     std::size_t _curly_level = 0;
     std::size_t _class_curly_level = 0;
     bool _has_trailing_return = false;
+    std::string _declaration;  // C++ since the last declaration, see update()
+    bool _in_comment = false;
+    std::vector<std::string> _scopes;  // enclosing namespaces, "{" for other scopes outside classes
+    bool _function_reports_exceptions = false;  // the current member function has a handler
+    bool _function_returns_void = false;        // reported errors may return from the function
+    bool _function_pulls = false;               // the current member function is a pull_task
+    std::vector<std::size_t> _parallel_for_levels;  // curly levels of enclosing $parallel_for
+    std::vector<std::size_t> _nested_functions;     // curly levels of enclosing lambdas/local classes
+    std::vector<body_scope> _body_scopes;           // scopes of enclosing $parallel_for bodies
+    std::vector<exception_handler_t> _exception_handlers;  // in the current line
+    std::vector<std::string> _includes;  // targets of all %#include directives
+    std::vector<class_info> _classes;    // classes at namespace scope parsed so far
+    bool _in_class_info = false;         // the current class is the last one in _classes
+    bool _in_function = false;           // in the body of a member function
+    function_info _function;             // the member function being parsed
 
     parse_context(std::istream& is,
                   std::ostream& os,
                   const std::string& filename,
-                  bool report_exceptions,
-                  bool line_directives)
+                  const compiler_options& options)
         : _is(is),
           _os(os),
           _filename{filename},
-          _report_exceptions{report_exceptions},
-          _line_directives{line_directives}
+          _report_exceptions{options._report_exceptions or
+                             options._report_exceptions_per_function},
+          _line_directives{options._line_directives},
+          _report_exceptions_per_function{options._report_exceptions_per_function},
+          _report_errors{options._report_errors},
+          _fast_compile{options._fast_compile},
+          _fuse_static_calls{options._fuse_static_calls},
+          _known_classes(options._known_classes)
     {
     }
 
     auto update(const line_data_t& line) -> void;
+    auto is_at_namespace_scope() const -> bool;  // not in anonymous namespaces, functions, etc
+    auto current_namespace() const -> std::string;
   };
 
   struct parse_error : public std::runtime_error
@@ -54,8 +54,12 @@ struct KisteTemplate_t
       {
       _serialize.text("#include <exception>\n");
       }
-    _serialize.text("#include <kiste/terminal.h>\n"
-                    "\n");
+    _serialize.text("#include <kiste/terminal.h>\n");
+      if (data._fast_compile)
+      {
+      _serialize.text("#include <kiste/void_call.h>\n");
+      }
+    _serialize.text("\n");
       if (data._line_directives)
       {
       _serialize.text("#line 1 \"");_serialize.escape(data._filename);_serialize.text("\"\n");
@@ -67,6 +71,29 @@ struct KisteTemplate_t
     _serialize.text("\n");
     }
 
+    template<typename Includes, typename Types>
+    void render_instantiation_declarations(const Includes& includes, const Types& types)
+    {
+    _serialize.text("// The instantiations are defined in a separate file, see kiste2cpp --instantiate\n");
+      for (const auto& include : includes)
+      {
+      _serialize.raw(include);_serialize.text("\n");
+      }
+      for (const auto& type : types)
+      {
+      _serialize.text("extern template struct ");_serialize.raw(type);_serialize.text(";\n");
+      }
+    }
+
+    template<typename Types>
+    void render_instantiation_definitions(const Types& types)
+    {
+      for (const auto& type : types)
+      {
+      _serialize.text("template struct ");_serialize.raw(type);_serialize.text(";\n");
+      }
+    }
+
 
 };
 
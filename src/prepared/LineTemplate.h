@@ -101,11 +101,20 @@ namespace kiste
       static_assert(std::is_same<decltype(open_exception_handling()), void>::value,
                     "$call{} requires void expression");
       (open_exception_handling());
-      _serialize.text("static_assert(std::is_same<decltype(");
-      _serialize.raw(expression);
-      _serialize.text("), void>::value, \"$call{} requires void expression\"); (");
-      _serialize.raw(expression);
-      _serialize.text(");");
+      if (data._fast_compile)
+      {
+        _serialize.text("static_cast<void>((");
+        _serialize.raw(expression);
+        _serialize.text("), ::kiste::void_call_t{});");
+      }
+      else
+      {
+        _serialize.text("static_assert(std::is_same<decltype(");
+        _serialize.raw(expression);
+        _serialize.text("), void>::value, \"$call{} requires void expression\"); (");
+        _serialize.raw(expression);
+        _serialize.text(");");
+      }
       static_assert(std::is_same<decltype(close_exception_handling(expression)), void>::value,
                     "$call{} requires void expression");
       (close_exception_handling(expression));
@@ -193,6 +202,10 @@ namespace kiste
                         "$call{} requires void expression");
           (raw(segment._text));
           break;
+        case segment_type::slot:
+          break;
+        case segment_type::flush:
+          break;
         }
       }
       if (not line._next_line_starts_with_text)
@@ -210,6 +223,26 @@ namespace kiste
       _serialize.raw(line._segments[0]._text);
       _serialize.text("\n");
     }
+
+    template <typename Line>
+    void render_parallel_for_begin(const Line& line)
+    {
+      _serialize.text("{ auto&& _kiste_range = (");
+      _serialize.raw(line._parallel_for._range);
+      _serialize.text("); ::kiste::parallel_for(_serialize, std::begin(_kiste_range), "
+                      "std::end(_kiste_range), [&](_serializer_t& _serialize, "
+                      "decltype(std::begin(_kiste_range)) _kiste_first, "
+                      "decltype(std::begin(_kiste_range)) _kiste_last) -> void { "
+                      "for (; _kiste_first != _kiste_last; ++_kiste_first) { ");
+      _serialize.raw(line._parallel_for._declaration);
+      _serialize.text(" = *_kiste_first;\n");
+    }
+
+    template <typename Line>
+    void render_parallel_for_end(const Line&)
+    {
+      _serialize.text("} }); }\n");
+    }
   };
 
   template <typename DATA_T, typename SERIALIZER_T>
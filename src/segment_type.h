@@ -34,6 +34,8 @@ namespace kiste
     trim_trailing_return,
     escape,
     raw,
-    call
+    call,
+    slot,
+    flush
   };
 }
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <algorithm>
+#include <iostream>
+#include "watch.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kiste
+{
+#ifdef __linux__
+  auto list_directory(const std::string& directory) -> std::vector<std::string>
+  {
+    auto names = std::vector<std::string>{};
+    auto dir = opendir(directory.c_str());
+    if (not dir)
+    {
+      return names;
+    }
+    while (const auto entry = readdir(dir))
+    {
+      // Skips ".", ".." and any other directories, which cannot be templates
+      auto is_file = entry->d_type == DT_REG;
+      if (entry->d_type == DT_UNKNOWN or entry->d_type == DT_LNK)
+      {
+        struct stat status;
+        const auto path = directory + "/" + entry->d_name;
+        is_file = stat(path.c_str(), &status) == 0 and S_ISREG(status.st_mode);
+      }
+      if (is_file)
+      {
+        names.push_back(entry->d_name);
+      }
+    }
+    closedir(dir);
+    return names;
+  }
+
+  auto watch_directory(const std::string& directory,
+                       const std::function<void()>& on_watching,
+                       const std::function<void(const std::string&)>& on_change) -> bool
+  {
+    const auto fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0)
+    {
+      std::cerr << "Could not initialize inotify: " << std::strerror(errno) << std::endl;
+      return false;
+    }
+    // Editors either write files in place or write a temporary file and rename it
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+      std::cerr << "Could not watch " << directory << ": " << std::strerror(errno) << std::endl;
+      close(fd);
+      return false;
+    }
+    on_watching();
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (true)
+    {
+      const auto length = read(fd, buffer, sizeof(buffer));
+      if (length < 0 and errno == EINTR)
+      {
+        continue;
+      }
+      if (length <= 0)
+      {
+        std::cerr << "Could not read inotify events: " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+      }
+
+      // Saving a file can trigger several events at once, handle each file only once per read
+      auto names = std::vector<std::string>{};
+      for (auto pos = buffer; pos < buffer + length;)
+      {
+        const auto event = reinterpret_cast<const inotify_event*>(pos);
+        if (event->len)
+        {
+          const auto name = std::string{event->name};
+          if (std::find(names.begin(), names.end(), name) == names.end())
+          {
+            names.push_back(name);
+          }
+        }
+        pos += sizeof(inotify_event) + event->len;
+      }
+      for (const auto& name : names)
+      {
+        on_change(name);
+      }
+    }
+  }
+#else
+  auto list_directory(const std::string&) -> std::vector<std::string>
+  {
+    return {};
+  }
+
+  auto watch_directory(const std::string&,
+                       const std::function<void()>&,
+                       const std::function<void(const std::string&)>&) -> bool
+  {
+    std::cerr << "Watching directories is not supported on this platform" << std::endl;
+    return false;
+  }
+#endif
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <kiste/any_serializer.h>
+#include <kiste/html.h>
+#include <sample.h>
+
+namespace
+{
+  struct Data
+  {
+    std::string title;
+    unsigned count;
+    double price;
+    std::string unit;
+    long delta;
+    char symbol;
+    std::vector<std::string> items;
+  };
+
+  template <typename Serializer>
+  auto render(const Data& data, Serializer& serializer) -> void
+  {
+    test::Sample(data, serializer).render();
+  }
+}
+
+int main()
+{
+  // Strings with embedded NULs cannot be passed on in place
+  auto data = Data{std::string{"<Fruit & Veg>"} + '\0' + " & more",
+                   3,
+                   1.25,
+                   std::string{"<b>EUR</b>"} + '\0',
+                   -7,
+                   '<',
+                   {}};
+  for (auto i = 0; i < 200; ++i)
+  {
+    data.items.push_back("Item \"" + std::to_string(i) + "\"");
+  }
+
+  std::ostringstream expected;
+  {
+    auto serializer = kiste::html{expected};
+    render(data, serializer);
+  }
+
+  // Small chunks to exercise the chunked forwarding
+  std::ostringstream actual;
+  {
+    kiste::any_serializer_backend_t<kiste::html> backend{actual};
+    auto serializer = kiste::any_serializer{backend, 64};
+    render(data, serializer);
+    serializer.flush();
+  }
+
+  if (actual.str() != expected.str())
+  {
+    std::cerr << "Unexpected output:\n" << actual.str() << "\nexpected:\n" << expected.str()
+              << std::endl;
+    return 1;
+  }
+}
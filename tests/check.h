@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef KISS_TEMPLATES_TESTS_CHECK_H
+#define KISS_TEMPLATES_TESTS_CHECK_H
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <string>
+
+namespace
+{
+  // Reports a failed condition. Messages given as literals are not copied, so checks do not
+  // allocate.
+  inline auto check(bool condition, const char* message) -> bool
+  {
+    if (not condition)
+    {
+      std::cerr << "Failed: " << message << std::endl;
+    }
+    return condition;
+  }
+
+  inline auto check(bool condition, const std::string& message) -> bool
+  {
+    return check(condition, message.c_str());
+  }
+
+  // Also reports the output that was checked
+  inline auto check(bool condition, const std::string& message, const std::string& output) -> bool
+  {
+    if (not condition)
+    {
+      std::cerr << "Failed: " << message << ", output:\n" << output << std::endl;
+    }
+    return condition;
+  }
+}
+
+#endif
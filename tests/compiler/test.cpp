@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <kiste/compiler.h>
+#include "../check.h"
+
+namespace
+{
+  auto contains(const std::string& text, const std::string& part) -> bool
+  {
+    return text.find(part) != text.npos;
+  }
+
+  const auto hello_world = std::string{
+      "%#include <Parent.h>\n"
+      "%namespace test\n"
+      "%{\n"
+      "  $class Hello\n"
+      "  %auto render() -> void\n"
+      "  %{\n"
+      "    Hello ${data.name}!\n"
+      "  %}\n"
+      "  $endclass\n"
+      "%}\n"};
+}
+
+int main()
+{
+  auto ok = true;
+
+  {
+    const auto result = kiste::compile(hello_world, "hello_world.kiste");
+    ok &= check(result._success, "valid template compiles");
+    ok &= check(result._diagnostics.empty(), "no diagnostics for valid template");
+    ok &= check(contains(result._code, "struct Hello_t"), "class is generated");
+    ok &= check(contains(result._code, "#line 1 \"hello_world.kiste\""),
+                "line directives refer to the file");
+    ok &= check(result._includes.size() == 1 and result._includes.front() == "Parent.h",
+                "includes are reported");
+  }
+
+  {
+    auto options = kiste::compiler_options{};
+    options._line_directives = false;
+    const auto result = kiste::compile(hello_world, "hello_world.kiste", options);
+    ok &= check(result._success, "valid template compiles without line directives");
+    ok &= check(not contains(result._code, "#line"), "line directives can be turned off");
+
+    std::istringstream is{hello_world};
+    std::ostringstream os;
+    const auto stream_result = kiste::compile(is, os, "hello_world.kiste", options);
+    ok &= check(stream_result._success and stream_result._code.empty(),
+                "stream interface compiles");
+    ok &= check(os.str() == result._code, "stream and string interface agree");
+  }
+
+  {
+    const auto result =
+        kiste::compile("$class A\n%auto f() -> void\n%{\n  ${x\n%}\n$endclass\n", "broken.kiste");
+    ok &= check(not result._success, "invalid template fails");
+    ok &= check(result._code.empty(), "no code for invalid template");
+    ok &= check(result._diagnostics.size() == 1, "invalid template yields a diagnostic");
+    if (result._diagnostics.size() == 1)
+    {
+      const auto& d = result._diagnostics.front();
+      ok &= check(d._filename == "broken.kiste", "diagnostic names the file");
+      ok &= check(d._line_no == 4, "diagnostic names the line number");
+      ok &= check(d._message == "missing closing brace", "diagnostic names the problem");
+      ok &= check(d._line == "  ${x", "diagnostic contains the line");
+    }
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n  $call{g(x)}\n"
+        "$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success, "$call{} in $parallel_for fails");
+    ok &= check(result._diagnostics.size() == 1 and result._diagnostics.front()._line_no == 5 and
+                    result._diagnostics.front()._message ==
+                        "$call{} cannot be used in $parallel_for",
+                "$call{} in $parallel_for is diagnosed");
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n  $slot{x}\n"
+        "$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._message ==
+                        "$slot{} cannot be used in $parallel_for",
+                "$slot{} in $parallel_for is diagnosed");
+  }
+
+  {
+    // Chunks of the body are rendered separately, break and return would only end one of them
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n  %if (x)\n  %{\n"
+        "    %break;\n  %}\n$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._line_no == 7 and
+                    result._diagnostics.front()._message == "break cannot be used in $parallel_for",
+                "break in $parallel_for is diagnosed");
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n  %if (x) return;\n"
+        "$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._message ==
+                        "return cannot be used in $parallel_for",
+                "return in $parallel_for is diagnosed");
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n"
+        "  %for (auto y : x.ys)\n  %{\n    %if (y) break;\n  %}\n"
+        "  %const auto g = [&](int y)\n  %{\n    %return y;\n  %};\n"
+        "$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(result._success, "break and return in loops and lambdas in $parallel_for compile");
+  }
+
+  {
+    // Unbalanced curly braces in the body are reported at $endfor, not at the end of the file
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n$parallel_for (auto x : data.xs)\n  %if (x)\n  %{\n"
+        "    ${x}\n$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._line_no == 8 and
+                    result._diagnostics.front()._message ==
+                        "Not enough closing curly braces in $parallel_for",
+                "unclosed curly brace in $parallel_for is diagnosed at $endfor");
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n%{\n$parallel_for (auto x : data.xs)\n  ${x}\n%}\n"
+        "$endfor\n%}\n$endclass\n",
+        "parallel.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._line_no == 8 and
+                    result._diagnostics.front()._message ==
+                        "Too many closing curly braces in $parallel_for",
+                "extra closing curly brace in $parallel_for is diagnosed at $endfor");
+  }
+
+  {
+    const auto result = kiste::compile(
+        "$class A\n%auto f() -> void\n%{\n  <head/>$flush\n  $flushed\n%}\n$endclass\n",
+        "flush.kiste");
+    ok &= check(not result._success and result._diagnostics.size() == 1 and
+                    result._diagnostics.front()._line_no == 5,
+                "$flush must not be followed by an identifier");
+  }
+
+  return ok ? 0 : 1;
+}
@@ -17,8 +17,8 @@ if __name__ == '__main__':
 
     with open(a_file_path, 'rb') as a:
         with open(b_file_path, 'rb') as b:
-            a_content = normalize(a.read())
-            b_content = normalize(b.read())
+            a_content = normalize(a.read().decode('utf-8'))
+            b_content = normalize(b.read().decode('utf-8'))
             if a_content == b_content:
                 exit(0)
             import difflib
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/http_chunked_sink.h>
+#include <kiste/raw.h>
+#include "data.h"
+#include "../check.h"
+#include <page.h>
+
+namespace
+{
+  // Splits a chunked body into its chunks, returns false if the framing is broken
+  auto parse_chunks(const std::string& body, std::vector<std::string>& chunks) -> bool
+  {
+    auto pos = std::size_t{0};
+    while (true)
+    {
+      const auto header_end = body.find("\r\n", pos);
+      if (header_end == std::string::npos)
+        return false;
+      const auto size = std::strtoul(body.substr(pos, header_end - pos).c_str(), nullptr, 16);
+      pos = header_end + 2;
+      if (size == 0)
+        return body.substr(pos) == "\r\n";
+      if (body.compare(pos + size, 2, "\r\n") != 0)
+        return false;
+      chunks.push_back(body.substr(pos, size));
+      pos += size + 2;
+    }
+  }
+
+  auto render_serially(const test::PageData& page) -> std::string
+  {
+    std::ostringstream os;
+    auto serializer = kiste::html{os};
+    test::Page(page, serializer).render();
+    return os.str();
+  }
+}
+
+int main()
+{
+  auto ok = true;
+  auto page = test::PageData{"<kiste>", {}};
+  for (int i = 0; i < 100; ++i)
+  {
+    page.lines.push_back("line " + std::to_string(i));
+  }
+  const auto expected = render_serially(page);
+  const auto head = std::string{"    <head><title>&lt;kiste&gt;</title></head>"};
+
+  {
+    auto body = std::string{};
+    auto writes = std::size_t{0};
+    kiste::http_chunked_sink sink{[&](const char* data, std::size_t size)
+                                  {
+                                    ++writes;
+                                    body.append(data, size);
+                                  }};
+    auto serializer = kiste::html{sink.stream()};
+    test::Page(page, serializer).render();
+    ok &= check(writes == 2, "each $flush writes a chunk");
+    sink.finish();
+    auto chunks = std::vector<std::string>{};
+    ok &= check(parse_chunks(body, chunks), "chunks are framed correctly");
+    ok &= check(chunks.size() == 3, "each flushed region is one chunk");
+    ok &= check(not chunks.empty() and chunks.front() == head, "the head is flushed first");
+    auto joined = std::string{};
+    for (const auto& chunk : chunks)
+    {
+      joined += chunk;
+    }
+    ok &= check(joined == expected, "chunks form the page");
+  }
+
+  {
+    auto body = std::string{};
+    kiste::http_chunked_sink sink{[&](const char* data, std::size_t size) { body.append(data, size); },
+                                  64};
+    auto serializer = kiste::html{sink.stream()};
+    test::Page(page, serializer).render();
+    sink.finish();
+    auto chunks = std::vector<std::string>{};
+    ok &= check(parse_chunks(body, chunks), "split chunks are framed correctly");
+    auto joined = std::string{};
+    auto bounded = true;
+    for (const auto& chunk : chunks)
+    {
+      bounded &= chunk.size() <= 64;
+      joined += chunk;
+    }
+    ok &= check(bounded and joined == expected, "large regions are split at the capacity");
+  }
+
+  {
+    // kiste::raw has no flush(), $flush is ignored
+    std::ostringstream os;
+    auto serializer = kiste::raw{os};
+    test::Page(page, serializer).render();
+    ok &= check(os.str().compare(0, 21, "    <head><title><kis") == 0, "$flush without flush()");
+  }
+
+  return ok ? 0 : 1;
+}
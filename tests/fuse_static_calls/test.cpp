@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <page.h>
+#include <kiste/html.h>
+
+namespace
+{
+  struct Data
+  {
+    std::string title;
+  };
+
+  const auto expected = std::string{
+      "        <html>\n"
+      "    <body>\n"
+      "\n"
+      "        <main>\n"
+      "        <nav><a href=\"/\">Home</a></nav>\n"
+      "\n"
+      "    <h1>Fish &amp; Chips</h1>\n"
+      "        <p>(c) \"Somebody\"</p>\n"
+      "\n"
+      "        Hello\n"
+      "\n"
+      "    </main>\n"
+      "\n"
+      "        </body>\n"
+      "    </html>\n"
+      "\n"};
+}
+
+// Built with and without --fuse-static-calls, the output has to be the same
+int main()
+{
+  const auto data = Data{"Fish & Chips"};
+  std::ostringstream os;
+  auto serializer = kiste::html{os};
+  test::Page(data, serializer).render();
+
+  if (os.str() != expected)
+  {
+    std::cerr << "Unexpected output:\n" << os.str() << std::endl;
+    return 1;
+  }
+}
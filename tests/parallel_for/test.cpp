@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <kiste/html.h>
+#include <kiste/parallel_for.h>
+#include "data.h"
+#include <table.h>
+
+namespace test
+{
+  struct Serializer : public kiste::html
+  {
+    using kiste::html::html;
+  };
+
+  std::atomic<std::size_t> clone_count(0);
+}
+
+// Small chunks, to get many of them with little data, and threads even on a single core
+namespace kiste
+{
+  template <>
+  struct parallel_traits<test::Serializer>
+  {
+    static auto threshold() -> std::size_t
+    {
+      return 64;
+    }
+
+    static auto chunk_size() -> std::size_t
+    {
+      return 16;
+    }
+
+    static auto pool() -> work_stealing_pool&
+    {
+      static work_stealing_pool pool{3};
+      return pool;
+    }
+
+    static auto clone(test::Serializer&, std::ostream& os) -> test::Serializer
+    {
+      ++test::clone_count;
+      return test::Serializer{os};
+    }
+
+    static auto splice(test::Serializer& serialize, const std::string& chunk) -> void
+    {
+      serialize.raw(chunk);
+    }
+  };
+}
+
+namespace
+{
+  auto make_data(std::size_t size) -> test::Data
+  {
+    auto data = test::Data{};
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      // Chunks must be spliced with their full length, including embedded NULs
+      auto label = "<row " + std::to_string(i) + ">";
+      if (i % 100 == 50)
+        label += std::string(1, '\0') + "after NUL";
+      data.rows.push_back({label, static_cast<int>(i)});
+    }
+    return data;
+  }
+
+  template <typename Serializer>
+  auto check_same_output(std::size_t size) -> bool
+  {
+    const auto data = make_data(size);
+    std::ostringstream serial;
+    auto serial_serializer = Serializer{serial};
+    test::Table(data, serial_serializer).render_serial();
+
+    std::ostringstream parallel;
+    auto parallel_serializer = Serializer{parallel};
+    test::Table(data, parallel_serializer).render();
+
+    if (serial.str() != parallel.str())
+    {
+      std::cerr << "Parallel output differs for " << size << " rows" << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
+
+int main()
+{
+  for (const auto size : {0, 1, 63, 64, 65, 1000, 100000})
+  {
+    if (not check_same_output<test::Serializer>(size))
+      return 1;
+  }
+  for (const auto size : {10, 100000})
+  {
+    if (not check_same_output<kiste::html>(size))
+      return 1;
+  }
+
+  test::clone_count = 0;
+  check_same_output<test::Serializer>(63);
+  if (test::clone_count != 0)
+  {
+    std::cerr << "Expected serial rendering below the threshold" << std::endl;
+    return 1;
+  }
+  check_same_output<test::Serializer>(1000);
+  if (test::clone_count != (1000 + 15) / 16)
+  {
+    std::cerr << "Unexpected number of chunks: " << test::clone_count << std::endl;
+    return 1;
+  }
+}
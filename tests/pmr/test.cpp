@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <kiste/buffer_stream.h>
+#include <kiste/html.h>
+#include <kiste/http_chunked_sink.h>
+#include "data.h"
+#include "../check.h"
+#include <page.h>
+
+namespace
+{
+  std::size_t global_allocations = 0;
+}
+
+auto operator new(std::size_t size) -> void*
+{
+  ++global_allocations;
+  if (auto p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+auto operator delete(void* p) noexcept -> void
+{
+  std::free(p);
+}
+
+auto operator delete(void* p, std::size_t) noexcept -> void
+{
+  std::free(p);
+}
+
+int main()
+{
+  auto ok = true;
+  const auto expected = std::string{
+      "    <h1>&lt;Title&gt; with a title that is too long for short string optimization</h1>\n"
+      "      <li>&lt;first item&gt; with some more text to leave the small buffer</li>\n"
+      "      <li>&lt;second item&gt; with some more text to leave the small buffer</li>\n"
+      "    <b>a note that is raw and long enough to need an allocation</b>\n"
+      "    <footer>a raw footer that is long enough to need an allocation</footer>\n"};
+
+  // All allocations while rendering come from the arena, which has no upstream
+  auto storage = std::array<std::byte, 16384>{};
+  auto arena = std::pmr::monotonic_buffer_resource{storage.data(), storage.size(),
+                                                   std::pmr::null_memory_resource()};
+  auto data = test::PageData{
+      "<Title> with a title that is too long for short string optimization",
+      {},
+      {std::pmr::string{"<b>a note that is raw and long enough to need an allocation</b>", &arena},
+       true},
+      "<footer>a raw footer that is long enough to need an allocation</footer>",
+      &arena};
+  data.items.emplace_back("<first item> with some more text to leave the small buffer", &arena);
+  data.items.emplace_back("<second item> with some more text to leave the small buffer", &arena);
+
+  {
+    const auto before = global_allocations;
+    auto output = std::pmr::string{&arena};
+    output.reserve(1024);
+    kiste::pmr_buffer_stream os(output);
+    auto serializer = kiste::html{os};
+    test::Page(data, serializer).render();
+    ok &= check(global_allocations == before, "rendering uses no global allocations");
+    ok &= check(std::string_view{output} == expected, "the output is rendered into the arena");
+  }
+
+  {
+    auto body = std::string{};
+    body.reserve(2048);
+    const auto before = global_allocations;
+    {
+      kiste::pmr_http_chunked_sink sink{
+          [&](const char* d, std::size_t size) { body.append(d, size); }, 1024, &arena};
+      auto serializer = kiste::html{sink.stream()};
+      test::Page(data, serializer).render();
+      sink.finish();
+    }
+    ok &= check(global_allocations <= before + 1, "the chunk buffer comes from the arena");
+    ok &= check(body.find(expected) != std::string::npos, "the chunked sink works with an arena");
+  }
+
+  return ok ? 0 : 1;
+}
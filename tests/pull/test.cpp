@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <kiste/html.h>
+#include <kiste/pull.h>
+#include "data.h"
+#include "../check.h"
+#include <page.h>
+
+namespace
+{
+  auto make_table(std::size_t rows) -> test::TableData
+  {
+    auto table = test::TableData{};
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      table.rows.push_back("<" + std::to_string(i) + ">");
+    }
+    return table;
+  }
+
+  auto expected_output(const test::TableData& table) -> std::string
+  {
+    auto result = std::string{"    <table>\n"};
+    for (const auto& row : table.rows)
+    {
+      result += "      <tr><td>&lt;" + row.substr(1, row.size() - 2) + "&gt;</td></tr>\n";
+    }
+    return result + "      <tr><td>&lt;total&gt;</td></tr>\n    </table>\n";
+  }
+}
+
+int main()
+{
+  auto ok = true;
+  constexpr auto chunk_size = std::size_t{256};
+
+  {
+    const auto table = make_table(1000);
+    kiste::pull_serializer<kiste::html> serializer{chunk_size};
+    auto page = test::Table(table, serializer);
+    auto output = std::string{};
+    auto chunks = std::size_t{0};
+    auto bounded = true;
+    for (const auto chunk : kiste::pull(page.render()))
+    {
+      ++chunks;
+      bounded &= chunk.size() < chunk_size + 64;
+      output += chunk;
+    }
+    ok &= check(output == expected_output(table), "pulled chunks form the page");
+    ok &= check(chunks > output.size() / (chunk_size + 64), "the page is pulled in chunks");
+    ok &= check(bounded, "chunks are bounded by the chunk size");
+
+    // The serializer can be used again
+    auto again = std::string{};
+    for (const auto chunk : kiste::pull(page.render()))
+    {
+      again += chunk;
+    }
+    ok &= check(again == output, "the serializer can be reused");
+  }
+
+  {
+    const auto table = make_table(3);
+    kiste::pull_serializer<kiste::html> serializer{chunk_size};
+    auto page = test::Table(table, serializer);
+    auto output = std::string{};
+    auto chunks = std::size_t{0};
+    for (const auto chunk : kiste::pull(page.render()))
+    {
+      ++chunks;
+      output += chunk;
+    }
+    ok &= check(chunks == 1 and output == expected_output(table), "small pages are one chunk");
+  }
+
+  {
+    auto table = make_table(1000);
+    table.fail_at = "<500>";
+    kiste::pull_serializer<kiste::html> serializer{chunk_size};
+    auto page = test::Table(table, serializer);
+    auto output = std::string{};
+    auto message = std::string{};
+    try
+    {
+      for (const auto chunk : kiste::pull(page.render()))
+      {
+        output += chunk;
+      }
+    }
+    catch (const std::runtime_error& e)
+    {
+      message = e.what();
+    }
+    ok &= check(message == "cannot render <500>", "exceptions are passed on");
+    ok &= check(output.size() >= chunk_size and output.find("&lt;500&gt;") == std::string::npos,
+                "chunks before the exception are delivered");
+  }
+
+  {
+    const auto table = make_table(1000);
+    kiste::pull_serializer<kiste::html> serializer{chunk_size};
+    auto page = test::Table(table, serializer);
+    auto first = std::string{};
+    for (const auto chunk : kiste::pull(page.render()))
+    {
+      first = std::string{chunk};
+      break;
+    }
+    ok &= check(first.compare(0, 11, "    <table>") == 0, "consumers may stop early");
+  }
+
+  {
+    const auto table = make_table(3);
+    kiste::pull_serializer<kiste::html> serializer{64};
+    auto page = test::Table(table, serializer);
+    auto output = std::string{};
+    auto chunks = std::size_t{0};
+    auto bounded = true;
+    for (const auto chunk : kiste::pull(page.notes()))
+    {
+      ++chunks;
+      bounded &= chunk.size() < 64 + 64;
+      output += chunk;
+    }
+    ok &= check(output.find("rows: 3") != std::string::npos and
+                    output.find("eighth") != std::string::npos,
+                "runs of text are pulled completely");
+    ok &= check(chunks > 1 and bounded, "runs of text are pulled in chunks");
+  }
+
+  return ok ? 0 : 1;
+}
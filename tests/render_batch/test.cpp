@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/render_batch.h>
+#include "data.h"
+#include "../check.h"
+#include <letter.h>
+
+namespace
+{
+  auto make_customers(std::size_t count) -> std::vector<test::Customer>
+  {
+    auto customers = std::vector<test::Customer>{};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      customers.push_back({"<customer " + std::to_string(i) + ">", static_cast<int>(i), false});
+    }
+    return customers;
+  }
+
+  auto render_serially(const test::Customer& customer) -> std::string
+  {
+    std::ostringstream os;
+    auto serializer = kiste::html{os};
+    test::Letter(customer, serializer).render();
+    return os.str();
+  }
+
+  // Collects the outputs of all sinks
+  struct outputs_t
+  {
+    std::mutex mutex;
+    std::vector<std::size_t> indexes;
+    std::map<std::size_t, std::string> texts;
+    std::size_t sinks = 0;
+  };
+
+  struct recording_sink
+  {
+    outputs_t* outputs;
+
+    auto operator()(std::size_t index, const std::string& text) -> void
+    {
+      std::lock_guard<std::mutex> lock(outputs->mutex);
+      outputs->indexes.push_back(index);
+      outputs->texts[index] = text;
+    }
+  };
+
+  // Sink factories are called under a lock
+  auto sink_factory(outputs_t& outputs) -> std::function<recording_sink()>
+  {
+    return [&outputs]
+    {
+      ++outputs.sinks;
+      return recording_sink{&outputs};
+    };
+  }
+
+  auto check_outputs(const std::vector<test::Customer>& customers, const outputs_t& outputs)
+      -> bool
+  {
+    if (outputs.texts.size() != customers.size() or outputs.indexes.size() != customers.size())
+      return false;
+    for (std::size_t i = 0; i < customers.size(); ++i)
+    {
+      if (outputs.texts.at(i) != render_serially(customers[i]))
+        return false;
+    }
+    return true;
+  }
+}
+
+int main()
+{
+  auto ok = true;
+  kiste::work_stealing_pool pool{3};
+  const auto customers = make_customers(5000);
+
+  for (const auto max_in_flight : {1, 2, 0})
+  {
+    auto options = kiste::batch_options{};
+    options._pool = &pool;
+    options._max_in_flight = static_cast<std::size_t>(max_in_flight);
+    outputs_t outputs;
+    const auto statistics = kiste::render_batch<kiste::html>(
+        test::Letter, customers, sink_factory(outputs), options);
+
+    auto in_order = true;
+    for (std::size_t i = 0; i < outputs.indexes.size(); ++i)
+    {
+      in_order &= outputs.indexes[i] == i;
+    }
+    ok &= check(check_outputs(customers, outputs), "ordered batch renders each record once");
+    ok &= check(in_order, "ordered batch delivers in order");
+    ok &= check(outputs.sinks == 1, "ordered batch uses a single sink");
+    ok &= check(statistics._records == customers.size(), "statistics count the records");
+    auto bytes = std::size_t{0};
+    for (const auto& text : outputs.texts)
+    {
+      bytes += text.second.size();
+    }
+    ok &= check(statistics._bytes == bytes, "statistics count the bytes");
+    ok &= check(statistics._threads >= 1 and statistics._threads <= pool.size() + 1,
+                "statistics count the threads");
+  }
+
+  {
+    auto options = kiste::batch_options{};
+    options._pool = &pool;
+    options._ordered = false;
+    outputs_t outputs;
+    const auto statistics = kiste::render_batch<kiste::html>(
+        test::Letter, customers, sink_factory(outputs), options);
+    ok &= check(check_outputs(customers, outputs), "unordered batch renders each record once");
+    ok &= check(outputs.sinks == statistics._threads, "unordered batch uses a sink per worker");
+  }
+
+  {
+    auto failing = make_customers(1000);
+    failing[500].fail = true;
+    auto options = kiste::batch_options{};
+    options._pool = &pool;
+    outputs_t outputs;
+    auto message = std::string{};
+    try
+    {
+      kiste::render_batch<kiste::html>(
+          test::Letter, failing, sink_factory(outputs), options);
+    }
+    catch (const std::runtime_error& e)
+    {
+      message = e.what();
+    }
+    ok &= check(message == "cannot render letter 500", "exceptions are passed on");
+    ok &= check(outputs.texts.size() <= 500, "records after a failure are not delivered");
+  }
+
+  {
+    outputs_t outputs;
+    const auto statistics = kiste::render_batch<kiste::html>(
+        test::Letter, std::vector<test::Customer>{},
+        sink_factory(outputs));
+    ok &= check(statistics._records == 0 and outputs.texts.empty(), "empty batches work");
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <kiste/html.h>
+#include "data.h"
+#include "../check.h"
+#include <page.h>
+
+namespace
+{
+  struct reported_error
+  {
+    long line_no;
+    std::string expression;
+    int code;
+  };
+
+  // Records errors and lets the test decide whether rendering continues
+  struct Serializer : public kiste::html
+  {
+    std::vector<reported_error> errors;
+    bool continue_after_error;
+
+    Serializer(std::ostream& os, bool continue_after_error_)
+        : kiste::html(os), continue_after_error(continue_after_error_)
+    {
+    }
+
+    auto report_error(long line_no, const char* expression, int code) -> bool
+    {
+      errors.push_back({line_no, expression, code});
+      return continue_after_error;
+    }
+  };
+
+  auto render(const test::Data& data, bool continue_after_error, std::vector<reported_error>& errors)
+      -> std::string
+  {
+    std::ostringstream os;
+    auto serializer = Serializer{os, continue_after_error};
+    test::Page(data, serializer).render();
+    errors = serializer.errors;
+    return os.str();
+  }
+}
+
+int main()
+{
+  auto errors = std::vector<reported_error>{};
+  auto data = test::Data{};
+
+  auto output = render(data, true, errors);
+  if (not check(output == "    Hello, &lt;World&gt;!\n      <footer>Bye</footer>\n    <p>3</p>\n" and
+                    errors.empty(),
+                "Unexpected output without errors", output))
+    return 1;
+
+  data.fail_name = true;
+  output = render(data, true, errors);
+  if (not check(output == "    Hello, !\n      <footer>Bye</footer>\n    <p>3</p>\n", "Rendering did not continue", output))
+    return 1;
+  if (not check(errors.size() == 1 and errors.front().expression == "data.name()" and
+                    errors.front().code == 2 and errors.front().line_no == 43,
+                "Unexpected error report", output))
+    return 1;
+
+  data.fail_name = false;
+  data.fail_title = true;
+  output = render(data, false, errors);
+  if (not check(output == "    Hello, &lt;World&gt;!\n      <footer></footer>\n    <p>3</p>\n",
+                "Rendering did not continue after the lambda", output))
+    return 1;
+  if (not check(errors.size() == 1 and errors.front().expression == "data.title()" and
+                    errors.front().code == 3,
+                "Unexpected error report", output))
+    return 1;
+
+  data.fail_title = false;
+  data.fail_greeting = true;
+  output = render(data, false, errors);
+  if (not check(output == "    ", "Rendering did not stop", output))
+    return 1;
+  if (not check(errors.size() == 1 and errors.front().expression == "greeting()" and
+                    errors.front().code == 7,
+                "Unexpected error report", output))
+    return 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef KISS_TEMPLATES_TESTS_SINKS_HELPERS_H
+#define KISS_TEMPLATES_TESTS_SINKS_HELPERS_H
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <kiste/html.h>
+#include "data.h"
+#include "../check.h"
+#include <row.h>
+
+namespace
+{
+  inline auto make_rows(std::size_t count, const std::string& name = "name")
+      -> std::vector<test::RowData>
+  {
+    auto rows = std::vector<test::RowData>{};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      rows.push_back({static_cast<int>(i), "<" + name + " " + std::to_string(i) + ">"});
+    }
+    return rows;
+  }
+
+  inline auto render(const std::vector<test::RowData>& rows, std::ostream& os) -> void
+  {
+    auto serializer = kiste::html{os};
+    for (const auto& row : rows)
+    {
+      test::Row(row, serializer).render();
+    }
+  }
+
+  inline auto render_serially(const std::vector<test::RowData>& rows) -> std::string
+  {
+    std::ostringstream os;
+    render(rows, os);
+    return os.str();
+  }
+
+  inline auto read_file(const std::string& name) -> std::string
+  {
+    std::ifstream is(name, std::ios::binary);
+    return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+  }
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/mmap_file_sink.h>
+#include "helpers.h"
+
+#include <sys/resource.h>
+
+int main()
+{
+  auto ok = true;
+  const auto rows = make_rows(20000);
+  std::ostringstream expected;
+  render(rows, expected);
+  const auto name = std::string{"mmap_file_sink.html"};
+
+  for (const auto populate : {false, true})
+  {
+    auto options = kiste::mmap_options{};
+    options._window_size = 10000;  // several windows
+    options._populate = populate;
+    options._huge_pages = populate;
+    kiste::mmap_file_sink sink{name, options};
+    render(rows, sink.stream());
+    ok &= check(sink.size() == expected.str().size(), "the size is counted");
+    sink.close();
+    ok &= check(read_file(name) == expected.str(), "the file contains the output");
+  }
+
+  {
+    {
+      kiste::mmap_file_sink sink{name};
+    }
+    ok &= check(read_file(name).empty(), "files without output are empty");
+  }
+  std::remove(name.c_str());
+
+  {
+    auto failed = false;
+    try
+    {
+      kiste::mmap_file_sink sink{"no/such/directory/file.html"};
+    }
+    catch (const std::system_error&)
+    {
+      failed = true;
+    }
+    ok &= check(failed, "open errors are reported");
+  }
+
+  {
+    // A file size limit stands in for a full disk, extending the file fails instead of SIGBUS
+    std::signal(SIGXFSZ, SIG_IGN);
+    auto limit = rlimit{};
+    ::getrlimit(RLIMIT_FSIZE, &limit);
+    const auto original_limit = limit;
+    limit.rlim_cur = 20000;
+    ::setrlimit(RLIMIT_FSIZE, &limit);
+    auto error = std::error_code{};
+    try
+    {
+      auto options = kiste::mmap_options{};
+      options._window_size = 10000;
+      kiste::mmap_file_sink sink{name, options};
+      render(rows, sink.stream());
+      sink.close();
+    }
+    catch (const std::system_error& e)
+    {
+      error = e.code();
+    }
+    ::setrlimit(RLIMIT_FSIZE, &original_limit);
+    std::remove(name.c_str());
+    ok &= check(error.value() == EFBIG, "errors while writing are reported by close()");
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/serializer_pool.h>
+#include "helpers.h"
+
+namespace
+{
+  // Collects its output until flushed
+  class buffering_serializer
+  {
+    std::ostream& _os;
+    std::ostringstream _pending;
+    kiste::html _html;
+
+  public:
+    buffering_serializer(std::ostream& os) : _os(os), _html(_pending)
+    {
+    }
+
+    auto text(const char* text) -> void
+    {
+      _html.text(text);
+    }
+
+    template <typename T>
+    auto escape(const T& t) -> void
+    {
+      _html.escape(t);
+    }
+
+    auto flush() -> void
+    {
+      _os << _pending.str();
+      _pending.str("");
+    }
+  };
+
+  template <typename Serializer>
+  auto render_row(Serializer& serializer, int id) -> void
+  {
+    test::Row(test::RowData{id, "<" + std::to_string(id) + ">"}, serializer).render();
+  }
+
+  auto expected(int id) -> std::string
+  {
+    std::ostringstream os;
+    auto serializer = kiste::html{os};
+    render_row(serializer, id);
+    return os.str();
+  }
+}
+
+int main()
+{
+  auto ok = true;
+
+  {
+    auto options = kiste::pool_options{};
+    options._initial_capacity = 1024;
+    options._max_capacity = 4096;
+    options._max_pooled = 2;
+    kiste::serializer_pool<kiste::html> pool{options};
+
+    const char* data = nullptr;
+    {
+      auto handle = pool.acquire();
+      render_row(handle.serializer(), 1);
+      ok &= check(handle.output() == expected(1), "the handle collects the output");
+      data = handle.output().data();
+    }
+    ok &= check(pool.pooled() == 1, "handles return their serializer");
+    {
+      auto handle = pool.acquire();
+      ok &= check(pool.pooled() == 0, "pooled serializers are handed out again");
+      ok &= check(handle.output().empty(), "pooled buffers are empty");
+      ok &= check(handle.output().data() == data, "pooled buffers are reused");
+      render_row(handle.serializer(), 2);
+      ok &= check(handle.output() == expected(2), "pooled serializers work");
+    }
+
+    {
+      auto handle = pool.acquire();
+      for (int i = 0; i < 1000; ++i)
+      {
+        render_row(handle.serializer(), i);
+      }
+      ok &= check(handle.output().capacity() > 4096, "buffers grow");
+      handle.reset();
+      ok &= check(not handle, "reset returns the serializer");
+      auto again = pool.acquire();
+      ok &= check(again.output().capacity() < 4096, "large buffers are shrunk");
+    }
+
+    {
+      auto handles = std::vector<kiste::serializer_pool<kiste::html>::handle>{};
+      for (int i = 0; i < 5; ++i)
+      {
+        handles.push_back(pool.acquire());
+      }
+    }
+    ok &= check(pool.pooled() == 2, "the number of pooled serializers is capped");
+
+    auto other_thread_pooled = std::size_t{1};
+    std::thread other{[&] { other_thread_pooled = pool.pooled(); }};
+    other.join();
+    ok &= check(other_thread_pooled == 0, "free lists are per thread");
+  }
+
+  {
+    auto options = kiste::pool_options{};
+    options._initial_capacity = 1024;
+    options._max_retained = 2048;
+    kiste::serializer_pool<kiste::html> pool{options};
+    {
+      auto a = pool.acquire();
+      auto b = pool.acquire();
+      auto c = pool.acquire();
+    }
+    ok &= check(pool.pooled() == 2, "the retained capacity is capped");
+  }
+
+  {
+    auto options = kiste::pool_options{};
+    options._max_pooled = 1;
+    kiste::serializer_pool<kiste::html> small{options};
+    kiste::serializer_pool<kiste::html> large;
+    {
+      auto a = large.acquire();
+      auto b = large.acquire();
+    }
+    ok &= check(large.pooled() == 2 and small.pooled() == 0, "free lists are per pool");
+    {
+      auto a = small.acquire();
+      auto b = small.acquire();
+    }
+    ok &= check(small.pooled() == 1, "each pool applies its own options");
+  }
+
+  {
+    kiste::serializer_pool<buffering_serializer> pool;
+    auto handle = pool.acquire();
+    render_row(handle.serializer(), 3);
+    ok &= check(handle.output() == expected(3), "buffered serializers are flushed for output()");
+  }
+
+  return ok ? 0 : 1;
+}
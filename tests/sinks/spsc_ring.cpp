@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/spsc_ring.h>
+#include "helpers.h"
+
+namespace
+{
+  // Reads everything from the ring, like an I/O thread would
+  auto read_all(kiste::spsc_ring& ring) -> std::string
+  {
+    auto result = std::string{};
+    while (not ring.done())
+    {
+      const auto spans = ring.readable();
+      for (const auto& span : spans)
+      {
+        result.append(span._data, span._size);
+      }
+      ring.consume(spans[0]._size + spans[1]._size);
+      if (spans[0]._size == 0)
+        std::this_thread::yield();
+    }
+    return result;
+  }
+
+  auto render_through_ring(const std::vector<test::RowData>& rows,
+                           std::size_t capacity,
+                           kiste::ring_full_policy policy,
+                           std::size_t& spilled) -> std::string
+  {
+    kiste::spsc_ring ring{capacity};
+    auto output = std::string{};
+    std::thread consumer{[&] { output = read_all(ring); }};
+    kiste::spsc_ring_sink sink{ring, policy};
+    auto serializer = kiste::html{sink.stream()};
+    spilled = 0;
+    for (const auto& row : rows)
+    {
+      test::Row(row, serializer).render();
+      spilled = std::max(spilled, sink.spilled());
+    }
+    sink.close();
+    consumer.join();
+    return output;
+  }
+}
+
+int main()
+{
+  auto ok = true;
+  const auto rows = make_rows(5000);
+  const auto expected = render_serially(rows);
+
+  {
+    kiste::spsc_ring ring{100};
+    ok &= check(ring.capacity() == 128, "the capacity is rounded up to a power of two");
+    auto span = ring.writable();
+    ok &= check(span._size == 128, "an empty ring is writable");
+    ring.commit(100);
+    ring.consume(ring.readable()[0]._size);
+    span = ring.writable();
+    ok &= check(span._size == 28, "writable space ends at the end of the buffer");
+    ring.commit(28);
+    ring.commit(10);
+    const auto spans = ring.readable();
+    ok &= check(spans[0]._size == 28 and spans[1]._size == 10, "wrapped output is two spans");
+  }
+
+  {
+    auto spilled = std::size_t{0};
+    const auto output = render_through_ring(rows, 256, kiste::ring_full_policy::wait, spilled);
+    ok &= check(output == expected, "waiting producer hands over everything");
+    ok &= check(spilled == 0, "waiting producer does not spill");
+  }
+
+  {
+    auto spilled = std::size_t{0};
+    const auto output = render_through_ring(rows, 256, kiste::ring_full_policy::spill, spilled);
+    ok &= check(output == expected, "spilling producer hands over everything in order");
+  }
+
+  {
+    // Nothing is consumed until the sink is closed, so the rest of the output has to spill
+    kiste::spsc_ring ring{64};
+    kiste::spsc_ring_sink sink{ring, kiste::ring_full_policy::spill};
+    auto serializer = kiste::html{sink.stream()};
+    for (const auto& row : make_rows(10))
+    {
+      test::Row(row, serializer).render();
+    }
+    ok &= check(sink.spilled() > 0, "output spills when the ring is full");
+    auto output = std::string{};
+    std::thread consumer{[&] { output = read_all(ring); }};
+    sink.close();
+    consumer.join();
+    ok &= check(output == render_serially(make_rows(10)), "spilled output follows in order");
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <kiste/html.h>
+#include <kiste/uring_sink.h>
+#include "helpers.h"
+
+namespace
+{
+  // Renders into several files at once, one row per file in turn
+  auto render_files(kiste::uring& ring) -> bool
+  {
+    constexpr auto files = 20;
+    auto ok = true;
+    auto rows = std::vector<std::vector<test::RowData>>{};
+    auto names = std::vector<std::string>{};
+    auto fds = std::vector<int>{};
+    auto sinks = std::vector<std::unique_ptr<kiste::uring_sink>>{};
+    for (int i = 0; i < files; ++i)
+    {
+      rows.push_back(make_rows(500, "file " + std::to_string(i)));
+      names.push_back("uring_sink_" + std::to_string(i) + ".html");
+      fds.push_back(::open(names.back().c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644));
+      sinks.emplace_back(new kiste::uring_sink{ring, fds.back()});
+    }
+    for (std::size_t row = 0; row < 500; ++row)
+    {
+      for (int i = 0; i < files; ++i)
+      {
+        auto serializer = kiste::html{sinks[i]->stream()};
+        test::Row(rows[i][row], serializer).render();
+      }
+    }
+    for (int i = 0; i < files; ++i)
+    {
+      sinks[i]->close();
+      ok &= ::lseek(fds[i], 0, SEEK_CUR) == static_cast<off_t>(read_file(names[i]).size());
+      ::close(fds[i]);
+      ok &= read_file(names[i]) == render_serially(rows[i]);
+      std::remove(names[i].c_str());
+    }
+    return ok;
+  }
+}
+
+int main()
+{
+  auto ok = true;
+
+  {
+    kiste::uring ring{32, 256};
+    std::cout << "io_uring: " << (ring.uses_io_uring() ? "yes" : "no")
+              << ", registered buffers: " << (ring.uses_registered_buffers() ? "yes" : "no")
+              << std::endl;
+    ok &= check(render_files(ring), "files are written via the uring");
+  }
+
+  {
+    kiste::uring ring{32, 256, false};
+    ok &= check(not ring.uses_io_uring(), "io_uring can be switched off");
+    ok &= check(render_files(ring), "files are written with write() as a fallback");
+  }
+
+  {
+    // Pipes are written in order
+    kiste::uring ring{4, 64};
+    int fds[2];
+    ok &= check(::pipe(fds) == 0, "pipe");
+    auto output = std::string{};
+    std::thread reader{[&]
+                       {
+                         char buffer[100];
+                         for (auto n = ::read(fds[0], buffer, sizeof(buffer)); n > 0;
+                              n = ::read(fds[0], buffer, sizeof(buffer)))
+                         {
+                           output.append(buffer, static_cast<std::size_t>(n));
+                         }
+                       }};
+    {
+      kiste::uring_sink sink{ring, fds[1]};
+      render(make_rows(1000), sink.stream());
+      sink.close();
+    }
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    ok &= check(output == render_serially(make_rows(1000)), "pipes are written in order");
+  }
+
+  {
+    kiste::uring ring{4, 64};
+    const auto fd = ::open("uring_sink_readonly.html", O_CREAT | O_RDONLY, 0644);
+    auto error = std::error_code{};
+    {
+      kiste::uring_sink sink{ring, fd};
+      render(make_rows(100), sink.stream());
+      try
+      {
+        sink.close();
+      }
+      catch (const std::system_error& e)
+      {
+        error = e.code();
+      }
+    }
+    ::close(fd);
+    std::remove("uring_sink_readonly.html");
+    ok &= check(error.value() == EBADF, "write errors are reported by close()");
+  }
+
+  {
+    // Each open sink holds a buffer, running out of them is reported by close()
+    kiste::uring ring{1, 64};
+    const auto fd = ::open("uring_sink_buffers.html", O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    auto error = std::error_code{};
+    {
+      kiste::uring_sink first{ring, fd};
+      kiste::uring_sink second{ring, fd};
+      first.stream() << "first";
+      second.stream() << "second";
+      try
+      {
+        second.close();
+      }
+      catch (const std::system_error& e)
+      {
+        error = e.code();
+      }
+      first.close();
+    }
+    ::close(fd);
+    std::remove("uring_sink_buffers.html");
+    ok &= check(error.value() == ENOBUFS, "running out of buffers is reported by close()");
+  }
+
+  return ok ? 0 : 1;
+}
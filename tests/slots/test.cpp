@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <kiste/html.h>
+#include <kiste/slots.h>
+#include "data.h"
+#include "../check.h"
+#include <page.h>
+
+namespace
+{
+  // Records the chunks passed to the sink
+  struct chunks_t
+  {
+    std::mutex mutex;
+    std::vector<std::string> chunks;
+
+    auto sink() -> kiste::slotted_output::sink_t
+    {
+      return [this](const char* data, std::size_t size)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.emplace_back(data, size);
+      };
+    }
+
+    auto text() -> std::string
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto result = std::string{};
+      for (const auto& chunk : chunks)
+      {
+        result += chunk;
+      }
+      return result;
+    }
+  };
+
+  const auto page = test::PageData{"<Title>", "body", {"a", "b"}};
+  const auto recommendations = test::RecommendationsData{{"x&y", "z"}};
+
+  const auto head = std::string{"    <h1>&lt;Title&gt;</h1>\n    "};
+  const auto rendered_recommendations = std::string{"      <a>x&amp;y</a>\n      <a>z</a>\n"};
+  const auto complete = head + rendered_recommendations + "\n    <p>body</p>\n    42\n" +
+                        "    <ul>\n      <li>A</li>\n      <li>B</li>\n    </ul>\n";
+}
+
+int main()
+{
+  auto ok = true;
+
+  {
+    chunks_t chunks;
+    kiste::slotted_output output{chunks.sink()};
+    kiste::slot_serializer<kiste::html> serializer{output};
+    test::Page(page, serializer).render();
+    ok &= check(chunks.text() == head, "the text before the first slot is passed on");
+    output.finish();
+    ok &= check(output.unfilled_slots() == 4, "unfilled slots are counted");
+
+    output.fill("counter", "42");
+    output.fill("b", "B");
+    output.fill("a", "A");
+    ok &= check(chunks.text() == head, "the text behind an unfilled slot is held back");
+
+    std::thread worker{[&output]
+                       {
+                         kiste::render_slot<kiste::html>(
+                             output, "recommendations", test::Recommendations, recommendations);
+                       }};
+    output.wait();
+    worker.join();
+    ok &= check(chunks.text() == complete, "filled slots are spliced in order");
+    ok &= check(output.unfilled_slots() == 0, "all slots are filled");
+  }
+
+  {
+    chunks_t chunks;
+    kiste::slotted_output output{chunks.sink()};
+    output.fill("recommendations", rendered_recommendations);
+    output.fill("counter", "42");
+    output.fill("a", "A");
+    output.fill("b", "B");
+    kiste::slot_serializer<kiste::html> serializer{output};
+    test::Page(page, serializer).render();
+    output.finish();
+    ok &= check(chunks.text() == complete, "slots can be filled before they are reached");
+  }
+
+  {
+    auto many = test::PageData{"many", "", {}};
+    auto expected = std::string{};
+    for (int i = 0; i < 200; ++i)
+    {
+      many.sections.push_back(std::to_string(i));
+      expected += "      <li>" + std::to_string(i * i) + "</li>\n";
+    }
+    chunks_t chunks;
+    kiste::slotted_output output{chunks.sink()};
+    output.fill("recommendations", "");
+    output.fill("counter", "");
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t)
+    {
+      workers.emplace_back(
+          [&output, t]
+          {
+            for (int i = 199 - t; i >= 0; i -= 4)
+            {
+              output.fill(std::to_string(i), std::to_string(i * i));
+            }
+          });
+    }
+    kiste::slot_serializer<kiste::html> serializer{output};
+    test::Page(many, serializer).render();
+    output.finish();
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+    output.wait();
+    const auto text = chunks.text();
+    const auto list = text.find("<ul>\n");
+    ok &= check(list != std::string::npos and text.substr(list + 5) == expected + "    </ul>\n",
+                "slots filled concurrently are spliced in order");
+  }
+
+  {
+    // The body flushes while a filling thread is calling the sink
+    std::mutex mutex;
+    std::condition_variable changed;
+    auto in_sink = false;
+    auto released = false;
+    auto text = std::string{};
+    kiste::slotted_output output{[&](const char* data, std::size_t size)
+                                 {
+                                   std::unique_lock<std::mutex> lock(mutex);
+                                   text.append(data, size);
+                                   if (std::string(data, size) == "S")
+                                   {
+                                     in_sink = true;
+                                     changed.notify_all();
+                                     changed.wait(lock, [&] { return released; });
+                                   }
+                                 }};
+    output.stream() << "a";
+    output.slot("s");
+    output.stream() << "b";
+    std::thread filler{[&output] { output.fill("s", "S"); }};
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] { return in_sink; });
+    }
+    output.flush();
+    output.stream() << "c";
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      released = true;
+      changed.notify_all();
+    }
+    filler.join();
+    ok &= check(text == "aSb", "a flush during another thread's flush is passed on");
+    output.finish();
+    ok &= check(text == "aSbc", "the body continues after such a flush");
+  }
+
+  return ok ? 0 : 1;
+}
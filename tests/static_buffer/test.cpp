@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015-2015, Roland Bock
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ *   Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ *   Redistributions in binary form must reproduce the above copyright notice, this
+ *   list of conditions and the following disclaimer in the documentation and/or
+ *   other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ciso646>  // Make MSCV understand and/or/not
+#include <iostream>
+#include <string_view>
+#include <kiste/static_buffer.h>
+#include "data.h"
+#include <error_page.h>
+
+namespace
+{
+  constexpr auto not_found = test::Data{404, "Not Found", "<missing> & \"gone\""};
+
+  constexpr auto expected = std::string_view{
+      "    <html><head><title>404 Not Found</title></head>\n"
+      "    <body>    <h1>404</h1><p>&lt;missing&gt; &amp; &quot;gone&quot;</p>"
+      "    <footer>&copy; kiste</footer>\n"
+      "\n"
+      "</body></html>\n"};
+
+  // Rendered by the compiler, nothing is left to do at runtime
+  constexpr auto page = kiste::render_static<test::ErrorPage, not_found>();
+  static_assert(page.size() == expected.size(), "");
+  static_assert(page.view() == expected, "");
+
+  constexpr auto padded = kiste::render_static<1024>(test::ErrorPage, not_found);
+  static_assert(padded.view() == expected, "");
+
+  constexpr auto fits(std::size_t capacity) -> bool
+  {
+    return capacity >= kiste::render_static<test::ErrorPage, not_found>().size();
+  }
+  static_assert(fits(expected.size()), "");
+}
+
+int main()
+{
+  if (page.view() != expected)
+  {
+    std::cerr << "Unexpected static output:\n" << page.view() << std::endl;
+    return 1;
+  }
+
+  // The same serializer works at runtime, too
+  const auto data = test::Data{500, "Internal Server Error", "7 > 3"};
+  auto buffer = kiste::static_buffer<1024>{};
+  test::ErrorPage(data, buffer).render();
+  if (buffer.view().find("<h1>500</h1><p>7 &gt; 3</p>") == std::string_view::npos)
+  {
+    std::cerr << "Unexpected runtime output:\n" << buffer.view() << std::endl;
+    return 1;
+  }
+
+  auto too_small = kiste::static_buffer<16>{};
+  try
+  {
+    test::ErrorPage(data, too_small).render();
+    std::cerr << "Expected std::length_error" << std::endl;
+    return 1;
+  }
+  catch (const std::length_error&)
+  {
+  }
+}
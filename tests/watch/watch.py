@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+from __future__ import print_function
+import os
+import shutil
+import subprocess
+import sys
+import threading
+
+try:
+    import queue
+except ImportError:
+    import Queue as queue
+
+# Seconds to wait for each line of kiste2cpp's output
+TIMEOUT = 10
+
+TEMPLATE = '''%namespace watch_test
+%{
+  $class Page
+
+  %auto render() -> void
+  %{
+    %s
+  %}
+
+  $endclass
+%}
+'''
+
+def fail(message):
+    print('Failed: %s' % message, file=sys.stderr)
+    exit(1)
+
+def write(path, content):
+    with open(path, 'w') as f:
+        f.write(content)
+
+def read(path):
+    with open(path) as f:
+        return f.read()
+
+def expect_line(lines, expected):
+    try:
+        line = lines.get(timeout=TIMEOUT)
+    except queue.Empty:
+        fail('Timed out waiting for "%s"' % expected)
+    if line is None:
+        fail('kiste2cpp exited while waiting for "%s"' % expected)
+    if not line.startswith(expected):
+        fail('Expected "%s", got "%s"' % (expected, line))
+
+if __name__ == '__main__':
+    assert len(sys.argv) == 3
+
+    kiste2cpp = sys.argv[1]
+    work_dir = sys.argv[2]
+    source_dir = os.path.join(work_dir, 'templates')
+    output_dir = os.path.join(work_dir, 'generated')
+    shutil.rmtree(work_dir, ignore_errors=True)
+    os.makedirs(source_dir)
+    os.makedirs(output_dir)
+
+    # Only regular files with the .kiste extension are templates
+    write(os.path.join(source_dir, 'page.kiste'), TEMPLATE.replace('%s', 'Hello'))
+    write(os.path.join(source_dir, 'notes.txt'), 'Not a template')
+    os.makedirs(os.path.join(source_dir, 'directory.kiste'))
+
+    process = subprocess.Popen(
+        [kiste2cpp, '--watch', source_dir, '--output-dir', output_dir],
+        stdout=subprocess.PIPE, universal_newlines=True)
+    lines = queue.Queue()
+
+    def read_lines():
+        for line in process.stdout:
+            lines.put(line.rstrip('\n'))
+        lines.put(None)
+
+    reader = threading.Thread(target=read_lines)
+    reader.daemon = True
+    reader.start()
+
+    try:
+        page = os.path.join(output_dir, 'page.h')
+        expect_line(lines, page + ': written')
+        if sorted(os.listdir(output_dir)) != ['page.h']:
+            fail('Unexpected output files %s' % sorted(os.listdir(output_dir)))
+        if 'Hello' not in read(page):
+            fail('page.h does not contain the initial text')
+
+        # Saving the template regenerates its header
+        write(os.path.join(source_dir, 'page.kiste'), TEMPLATE.replace('%s', 'Goodbye'))
+        expect_line(lines, page + ': written')
+        if 'Goodbye' not in read(page):
+            fail('page.h was not regenerated')
+
+        # Other files are ignored
+        write(os.path.join(source_dir, 'notes.txt'), 'Still not a template')
+        write(os.path.join(source_dir, 'page.kiste'), TEMPLATE.replace('%s', 'Goodbye'))
+        expect_line(lines, page + ': unchanged')
+    finally:
+        process.kill()
+        process.wait()